@@ -2,186 +2,1271 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
 
-#define N 4 // Número máximo de threads trabalhadoras
+#define N 4             // Número de threads trabalhadoras
+#define DEQUE_SIZE 1024 // Capacidade de cada deque local das trabalhadoras (potência de 2)
+#define SLOT_CHUNK 64   // Número de slots de resultado alocados de uma vez (bloco de IDs consecutivos)
+#define FREE_CHUNKS_MAX 8 // Blocos vazios guardados para reuso; os demais são liberados
+#define INLINE_INPUTS 4 // Dependências cujos resultados cabem no próprio slot, sem alocação
+#define HELP_SPIN 64            // Buscas sem sucesso de uma trabalhadora que espera um resultado antes de dormir
+#define HELP_WAIT_NS 1000000L   // Sono de uma trabalhadora que espera um resultado, entre buscas por outras tarefas
+
+#ifndef SCHED_TRACE
+#define SCHED_TRACE 1 // Compila o suporte a rastreamento (ativado em tempo de execução com setTracing)
+#endif
+#define HIST_SUB_BITS 4                       // Sub-faixas por potência de 2 nos histogramas (precisão de ~6%)
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
 
 /*
  - Neste exercício, implementamos um escalonador de tarefas que distribui tarefas entre N threads
-    trabalhadoras. O escalonador é composto por um buffer de tarefas e um buffer de resultados.
-    - O escalonador é inicializado com um buffer de tamanho fixo e uma quantidade de threads trabalhadoras.
+    trabalhadoras. O escalonador é composto por filas globais de injeção, deques locais em cada trabalhadora
+    e um buffer de resultados.
+    - O escalonador é inicializado com um buffer de tamanho fixo e cria N threads trabalhadoras persistentes.
     - As tarefas são agendadas com uma função de execução e argumentos, e um ID é retornado.
-    - As tarefas são executadas por threads trabalhadoras, que colocam o resultado no buffer de resultados.
+    - Tarefas agendadas de fora do escalonador entram na fila global de injeção (FIFO) da sua classe de prioridade,
+      que bloqueia quando cheia.
+    - Tarefas agendadas por uma trabalhadora (subtarefas) entram na deque local dela da sua classe (deque de Chase-Lev;
+      há uma para a prioridade normal e outra para a baixa), exceto as de alta prioridade, que sempre vão para a fila
+      de injeção de alta prioridade.
+      A dona da deque empilha e desempilha pela base (LIFO), e as outras trabalhadoras roubam pelo topo (FIFO)
+      quando ficam sem trabalho.
+    - As trabalhadoras buscam as classes em ordem de prioridade: a fila de alta prioridade, depois, para a normal e
+      em seguida para a baixa, a deque local, a fila de injeção e o roubo de outras trabalhadoras. Assim tarefas
+      sensíveis à latência passam na frente do trabalho em lote, mesmo de subtarefas em lote já enfileiradas.
+    - Uma tarefa pode ter um prazo (deadline). Se o prazo já passou quando uma trabalhadora a retira da fila, ela é
+      descartada sem executar e marcada como expirada no resultado.
+    - Para cada classe de prioridade são contabilizadas tarefas executadas, expiradas e o tempo de espera em fila.
+    - Uma tarefa pode depender de IDs agendados antes dela (scheduleExecutionAfter). Ela só entra em uma fila quando
+      todas as dependências terminam, e recebe os resultados delas como entradas. Quem conclui a última dependência
+      enfileira a tarefa, então nenhuma thread fica bloqueada esperando por arestas do grafo.
+    - Resultados intermediários de um grafo que ninguém vai ler podem ser descartados com discardExecutionResult,
+      liberando o slot assim que a tarefa terminar.
+    - Com SCHED_TRACE, o rastreamento pode ser ligado com setTracing. Cada thread registra, sem sincronização, em
+      histogramas log-lineares próprios (estilo HDR) o tempo em fila, da retirada até o início, de execução e do fim
+      até a coleta do resultado. Opcionalmente, o ciclo de vida de cada tarefa é gravado para ser exportado no formato
+      JSON do Chrome (chrome://tracing ou Perfetto) com dumpChromeTrace. Desligado, custa um teste por etapa.
+      No exemplo, o rastreamento só é ligado quando o caminho do JSON é passado como argumento (./ex5 trace.json).
     - O resultado de uma execução pode ser obtido com base no ID da execução, no qual a função bloqueia até que o resultado esteja disponível.
-    - A utilizção buffer de resultados é gerenciado por results_count, que é incrementado e decrementado conforme os resultados são armazenados e obtidos.
+      Se quem espera é uma trabalhadora, ela executa outras tarefas enquanto espera, evitando deadlock em
+      cargas fork-join (ex.: redução em árvore).
+    - Cada ID possui um slot próprio no buffer de resultados, com mutex e variável de condição próprios. Assim a
+      busca de um resultado é O(1) e apenas quem espera por aquele ID é acordado.
+    - Os slots são alocados em blocos de SLOT_CHUNK IDs consecutivos. A tabela de blocos cresce quando há muitos
+      resultados pendentes, e um bloco é reciclado assim que todos os seus resultados forem obtidos, então o
+      buffer de resultados nunca transborda nem bloqueia quem agenda.
+    - Os blocos vivos ficam em uma tabela hash de endereçamento aberto indexada pelo primeiro ID do bloco, que cresce
+      e encolhe com o número de blocos vivos (não com a distância entre o ID mais antigo e o mais novo). Até
+      FREE_CHUNKS_MAX blocos vazios são guardados para reuso, e os demais são liberados.
+    - O resultado é o próprio void * retornado pela função, sem cópia nem alocação por tarefa. Valores pequenos
+      podem ser retornados diretamente no ponteiro (ex.: (void *)(intptr_t)valor).
+    - Cada ID deve ter seu resultado obtido ou descartado exatamente uma vez, depois que todas as tarefas que dependem
+      dele foram agendadas.
     - O escalonador é sincronizado com mutex e variáveis de condição para garantir a sincronização entre as threads.
+ Referência da deque: "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al., PPoPP 2013).
  */
 
 // Estrutura que representa uma tarefa
 typedef struct
 {
     void *(*funexec)(void *); // Função a ser executada
+    void *(*funexec_inputs)(void *, void **, int); // Função a ser executada com os resultados das dependências
     void *args;               // Argumentos para a função
+    void **inputs;            // Resultados das dependências, na ordem em que foram declaradas
+    int num_inputs;           // Número de dependências
     int id;                   // Identificador da execução
+    int priority;             // Classe de prioridade (Priority)
+    long deadline_ns;         // Prazo absoluto em CLOCK_MONOTONIC, ou 0 se não houver prazo
 } Task;
 
-// Estrutura que armazena o resultado de uma execução
+// Classes de prioridade das tarefas
+typedef enum
+{
+    PRIORITY_HIGH,   // Tarefas sensíveis à latência
+    PRIORITY_NORMAL, // Prioridade padrão
+    PRIORITY_LOW,    // Trabalho em lote
+    NUM_PRIORITIES
+} Priority;
+
+// Situação de uma execução retornada por getExecutionResultStatus
+enum
+{
+    EXECUTION_DONE,    // A função foi executada e o resultado é válido
+    EXECUTION_EXPIRED, // O prazo expirou antes da execução, a função não foi executada
+    EXECUTION_UNKNOWN  // O ID não está vivo (não agendado ou resultado já obtido)
+};
+
+// Estados possíveis de um slot de resultado
+enum
+{
+    SLOT_FREE,    // Slot livre para um novo ID
+    SLOT_PENDING, // Tarefa agendada, resultado ainda não disponível
+    SLOT_READY    // Resultado disponível para ser obtido
+};
+
+struct SlotChunk;
+struct Dependent;
+
+// Slot que armazena a tarefa e o resultado de uma execução, indexado pelo ID
+typedef struct
+{
+    Task task;                      // Tarefa que ocupa o slot
+    int state;                      // Estado do slot (SLOT_FREE, SLOT_PENDING ou SLOT_READY)
+    int expired;                    // Indica que a tarefa foi descartada por prazo expirado
+    int detached;                   // Indica que o resultado foi descartado e o slot deve ser liberado ao terminar
+    long enqueue_ns;                // Instante em que a tarefa entrou em uma fila
+#if SCHED_TRACE
+    int trace_flags;                // Opções de rastreamento lidas uma vez ao retirar a tarefa da fila
+    long dequeue_ns;                // Instante em que a tarefa foi retirada da fila
+    long start_ns;                  // Instante em que a função começou a executar
+    long end_ns;                    // Instante em que o resultado foi publicado
+#endif
+    void *result;                   // Resultado da execução
+    atomic_int deps_remaining;      // Dependências ainda não concluídas
+    struct Dependent *dependents;   // Tarefas que esperam por este resultado
+    void *inline_inputs[INLINE_INPUTS]; // Entradas das dependências quando cabem no slot
+    struct SlotChunk *chunk;        // Bloco ao qual o slot pertence
+    pthread_mutex_t mutex;          // Mutex do slot
+    pthread_cond_t cond;            // Variável de condição do slot
+} ResultSlot;
+
+// Aresta do grafo de dependências: a tarefa de slot recebe o resultado na entrada index
+typedef struct Dependent
+{
+    ResultSlot *slot;       // Tarefa dependente
+    int index;              // Posição do resultado nas entradas da tarefa dependente
+    struct Dependent *next; // Próxima aresta
+} Dependent;
+
+// Bloco de slots para os IDs [base, base + SLOT_CHUNK)
+typedef struct SlotChunk
+{
+    int base;                   // Primeiro ID do bloco
+    int collected;              // Resultados do bloco já obtidos
+    int users;                  // Consultas por ID em andamento, que impedem o bloco de ser reciclado
+    int retired;                // Todos os resultados foram liberados e o bloco saiu da tabela
+    struct SlotChunk *next;     // Próximo bloco na lista de blocos livres
+    ResultSlot slots[SLOT_CHUNK];
+} SlotChunk;
+
+// Deque de Chase-Lev: apenas a dona usa push/take, as demais trabalhadoras usam steal
+typedef struct
+{
+    atomic_long top;                           // Próxima posição a ser roubada
+    atomic_long bottom;                        // Próxima posição livre da dona
+    _Atomic(ResultSlot *) tasks[DEQUE_SIZE];   // Tarefas da deque
+} Deque;
+
+// Estrutura que representa uma thread trabalhadora
+typedef struct
+{
+    pthread_t thread; // Thread da trabalhadora
+    int index;        // Índice da trabalhadora no escalonador
+    Deque deques[NUM_PRIORITIES - 1]; // Deques locais das prioridades normal e baixa (ver localDeque)
+} Worker;
+
+// Fila global de injeção (circular) de uma classe de prioridade
+typedef struct
+{
+    ResultSlot **buffer;     // Tarefas da fila
+    int head;                // Posição da próxima tarefa a ser retirada
+    atomic_int count;        // Número de tarefas na fila
+    pthread_cond_t not_full; // Variável de condição para a fila cheia
+} InjectionQueue;
+
+// Métricas de uma classe de prioridade
+typedef struct
+{
+    atomic_long executed;    // Tarefas executadas
+    atomic_long expired;     // Tarefas descartadas por prazo expirado
+    atomic_long wait_ns;     // Soma dos tempos de espera em fila
+    atomic_long max_wait_ns; // Maior tempo de espera em fila
+} ClassStats;
+
+#if SCHED_TRACE
+// Opções de rastreamento para setTracing
+enum
+{
+    TRACE_HISTOGRAMS = 1, // Histogramas de latência por etapa
+    TRACE_EVENTS = 2      // Eventos do ciclo de vida das tarefas para dumpChromeTrace
+};
+
+// Etapas medidas do ciclo de vida de uma tarefa
+enum
+{
+    STAGE_QUEUE,  // Do agendamento até a retirada da fila
+    STAGE_START,  // Da retirada da fila até o início da função
+    STAGE_EXEC,   // Execução da função
+    STAGE_PICKUP, // Do resultado publicado até a coleta em getExecutionResult
+    NUM_STAGES
+};
+
+// Histograma log-linear de latências em nanossegundos
 typedef struct
 {
-    int id;     // Identificador da execução
-    int result; // Resultado da execução
-} Result;
+    unsigned long count;                // Número de amostras
+    unsigned long sum;                  // Soma das amostras
+    unsigned long max;                  // Maior amostra
+    unsigned long buckets[HIST_BUCKETS]; // Amostras por faixa
+} Histogram;
+
+// Evento do ciclo de vida de uma tarefa, exportado para o formato do Chrome
+typedef struct
+{
+    const char *name; // Nome do evento
+    int async;        // 1 para intervalo assíncrono (fila, coleta), 0 para execução na thread
+    int id;           // ID da tarefa
+    long ts_ns;       // Início do intervalo
+    long dur_ns;      // Duração do intervalo
+} TraceEvent;
+
+// Dados de rastreamento de uma thread, escritos apenas por ela
+typedef struct ThreadTrace
+{
+    int tid;                        // Identificador da thread no rastreamento
+    Histogram stages[NUM_STAGES];   // Histogramas por etapa
+    TraceEvent *events;             // Eventos registrados
+    int events_count;               // Número de eventos registrados
+    int events_capacity;            // Capacidade do vetor de eventos
+    struct ThreadTrace *next;       // Próxima thread registrada
+} ThreadTrace;
+#endif
 
 // Estrutura que representa o escalonador
 typedef struct
 {
-    Task *buffer;               // Buffer para tarefas pendentes
-    int buffer_size;            // Tamanho do buffer
-    int buffer_count;           // Número de tarefas no buffer
-    int next_id;                // Próximo ID a ser atribuído
-    Result *results;            // Buffer para armazenar resultados
-    int results_count;          // Número de resultados armazenados
+    InjectionQueue queues[NUM_PRIORITIES]; // Filas de injeção, uma por classe de prioridade
+    int buffer_size;                       // Tamanho de cada fila de injeção
+    ClassStats stats[NUM_PRIORITIES];      // Métricas por classe de prioridade
+    unsigned next_id;           // Próximo ID a ser atribuído (módulo INT_MAX + 1, sempre um int não negativo)
+    SlotChunk **chunks;         // Tabela de blocos vivos (endereçamento aberto, sondagem linear pelo primeiro ID)
+    int chunks_size;            // Tamanho da tabela de blocos (potência de 2)
+    int chunks_min_size;        // Tamanho inicial, abaixo do qual a tabela não encolhe
+    int chunks_count;           // Blocos vivos na tabela
+    SlotChunk *free_chunks;     // Blocos reciclados, prontos para reuso
+    int free_chunks_count;      // Número de blocos reciclados guardados
+    Worker workers[N];          // Threads trabalhadoras
+    atomic_int pending;         // Tarefas enfileiradas (fila de injeção + deques) ainda não retiradas
+    atomic_int idle_workers;    // Trabalhadoras dormindo à espera de tarefas
+    int shutdown;               // Indica que o escalonador está sendo destruído
+#if SCHED_TRACE
+    atomic_int tracing;         // Opções de rastreamento ativas (TRACE_HISTOGRAMS | TRACE_EVENTS)
+    ThreadTrace *traces;        // Dados de rastreamento de cada thread que já registrou algo
+    int traces_count;           // Número de threads registradas
+#endif
     pthread_mutex_t mutex;      // Mutex para sincronização
-    pthread_cond_t cond;        // Variável de condição para sincronização
-    pthread_cond_t result_cond; // Variável de condição para resultados
+    pthread_cond_t work_cond;   // Variável de condição para trabalhadoras ociosas
 } Scheduler;
 
-Scheduler scheduler; // Instância global do escalonador
-// Inicializa o escalonador
+Scheduler scheduler;                        // Instância global do escalonador
+static _Thread_local Worker *current_worker; // Trabalhadora da thread atual (NULL fora do escalonador)
+#if SCHED_TRACE
+static _Thread_local ThreadTrace *current_trace; // Dados de rastreamento da thread atual
+static _Thread_local unsigned current_trace_generation; // Geração de trace_generation em que current_trace foi criado
+static atomic_uint trace_generation;             // Incrementada por destroyScheduler ao liberar os dados de rastreamento
+#endif
+
+// Retorna a deque local de uma trabalhadora para uma classe de prioridade (normal ou baixa)
+Deque *localDeque(Worker *w, int priority)
+{
+    return &w->deques[priority - PRIORITY_NORMAL];
+}
+
+// Empilha uma tarefa na base da deque, retorna 0 se a deque estiver cheia
+int dequePush(Deque *d, ResultSlot *slot)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_SIZE)
+        return 0;
+
+    atomic_store_explicit(&d->tasks[b & (DEQUE_SIZE - 1)], slot, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+// Desempilha uma tarefa da base da deque (usado apenas pela dona)
+ResultSlot *dequeTake(Deque *d)
+{
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    ResultSlot *slot = NULL;
+    if (t <= b)
+    {
+        slot = atomic_load_explicit(&d->tasks[b & (DEQUE_SIZE - 1)], memory_order_relaxed);
+        if (t == b)
+        {
+            // Última tarefa: disputa com possíveis ladrões
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed))
+                slot = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+
+    return slot;
+}
+
+// Rouba uma tarefa do topo da deque de outra trabalhadora
+ResultSlot *dequeSteal(Deque *d)
+{
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b)
+        return NULL;
+
+    ResultSlot *slot = atomic_load_explicit(&d->tasks[t & (DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return slot;
+}
+
+// Retorna a posição inicial de um bloco na tabela de blocos
+int chunkPosition(int base)
+{
+    return (base / SLOT_CHUNK) & (scheduler.chunks_size - 1);
+}
+
+// Insere um bloco na primeira posição livre a partir da sua posição inicial.
+// Deve ser chamada com scheduler.mutex travado
+void insertChunk(SlotChunk *chunk)
+{
+    int pos = chunkPosition(chunk->base);
+    while (scheduler.chunks[pos])
+        pos = (pos + 1) & (scheduler.chunks_size - 1);
+    scheduler.chunks[pos] = chunk;
+}
+
+// Recria a tabela de blocos com outro tamanho (potência de 2). Deve ser chamada com scheduler.mutex travado
+void resizeChunkTable(int size)
+{
+    SlotChunk **old = scheduler.chunks;
+    int old_size = scheduler.chunks_size;
+
+    scheduler.chunks = (SlotChunk **)calloc(size, sizeof(SlotChunk *));
+    scheduler.chunks_size = size;
+    for (int i = 0; i < old_size; i++)
+        if (old[i])
+            insertChunk(old[i]);
+    free(old);
+}
+
+// Remove um bloco da tabela, puxando para trás os blocos seguintes da mesma sequência de sondagem para que nenhuma
+// busca pare antes deles. Deve ser chamada com scheduler.mutex travado
+void removeChunk(SlotChunk *chunk)
+{
+    int mask = scheduler.chunks_size - 1;
+    int hole = chunkPosition(chunk->base);
+    while (scheduler.chunks[hole] != chunk)
+        hole = (hole + 1) & mask;
+    scheduler.chunks[hole] = NULL;
+
+    for (int pos = (hole + 1) & mask; scheduler.chunks[pos]; pos = (pos + 1) & mask)
+    {
+        // O bloco em pos pode ocupar o buraco se a sua posição inicial não está no trecho (hole, pos]
+        int home = chunkPosition(scheduler.chunks[pos]->base);
+        if (((pos - home) & mask) >= ((pos - hole) & mask))
+        {
+            scheduler.chunks[hole] = scheduler.chunks[pos];
+            scheduler.chunks[pos] = NULL;
+            hole = pos;
+        }
+    }
+
+    scheduler.chunks_count--;
+    if (scheduler.chunks_size > scheduler.chunks_min_size && scheduler.chunks_count * 8 < scheduler.chunks_size)
+        resizeChunkTable(scheduler.chunks_size / 2);
+}
+
+// Aloca (ou recicla) o bloco que começa no ID base e o registra na tabela, mantendo a ocupação abaixo da metade.
+// Deve ser chamada com scheduler.mutex travado
+void allocChunk(int base)
+{
+    if ((scheduler.chunks_count + 1) * 2 > scheduler.chunks_size)
+        resizeChunkTable(scheduler.chunks_size * 2);
+
+    SlotChunk *chunk = scheduler.free_chunks;
+    if (chunk)
+    {
+        scheduler.free_chunks = chunk->next;
+        scheduler.free_chunks_count--;
+    }
+    else
+    {
+        chunk = (SlotChunk *)calloc(1, sizeof(SlotChunk));
+        for (int i = 0; i < SLOT_CHUNK; i++)
+        {
+            chunk->slots[i].chunk = chunk;
+            pthread_mutex_init(&chunk->slots[i].mutex, NULL);
+            pthread_cond_init(&chunk->slots[i].cond, NULL);
+        }
+    }
+
+    chunk->base = base;
+    chunk->collected = 0;
+    chunk->users = 0;
+    chunk->retired = 0;
+    for (int i = 0; i < SLOT_CHUNK; i++)
+        chunk->slots[i].state = SLOT_FREE;
+    insertChunk(chunk);
+    scheduler.chunks_count++;
+}
+
+// Retorna o bloco que contém um ID, ou NULL se o ID não estiver vivo.
+// Deve ser chamada com scheduler.mutex travado
+SlotChunk *chunkForId(int id)
+{
+    if (id < 0)
+        return NULL;
+    int base = id - id % SLOT_CHUNK;
+    for (int pos = chunkPosition(base); scheduler.chunks[pos]; pos = (pos + 1) & (scheduler.chunks_size - 1))
+        if (scheduler.chunks[pos]->base == base)
+            return scheduler.chunks[pos];
+    return NULL;
+}
+
+// Libera um bloco de slots
+void freeChunk(SlotChunk *chunk)
+{
+    for (int i = 0; i < SLOT_CHUNK; i++)
+    {
+        pthread_mutex_destroy(&chunk->slots[i].mutex);
+        pthread_cond_destroy(&chunk->slots[i].cond);
+    }
+    free(chunk);
+}
+
+// Contabiliza resultados liberados (collected) e o fim de uma consulta (unpin) em um bloco. O bloco sai da tabela
+// quando todos os seus resultados foram liberados, e é reciclado ou liberado quando nenhuma consulta o usa mais.
+// Deve ser chamada com scheduler.mutex travado
+void releaseChunk(SlotChunk *chunk, int collected, int unpin)
+{
+    chunk->collected += collected;
+    chunk->users -= unpin;
+    if (!chunk->retired && chunk->collected == SLOT_CHUNK)
+    {
+        removeChunk(chunk);
+        chunk->retired = 1;
+    }
+    if (!chunk->retired || chunk->users > 0)
+        return;
+
+    if (scheduler.free_chunks_count < FREE_CHUNKS_MAX)
+    {
+        chunk->next = scheduler.free_chunks;
+        scheduler.free_chunks = chunk;
+        scheduler.free_chunks_count++;
+    }
+    else
+        freeChunk(chunk);
+}
+
+// Retorna o instante atual de CLOCK_MONOTONIC em nanossegundos
+long nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+#if SCHED_TRACE
+// Retorna as opções de rastreamento ativas
+int tracingFlags()
+{
+    return atomic_load_explicit(&scheduler.tracing, memory_order_relaxed);
+}
+
+// Retorna a faixa do histograma de um valor: exata abaixo de HIST_SUB, depois HIST_SUB faixas por potência de 2
+int histogramBucket(unsigned long value)
+{
+    if (value < HIST_SUB)
+        return (int)value;
+    int shift = 63 - __builtin_clzl(value) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((value >> shift) & (HIST_SUB - 1));
+}
+
+// Retorna o menor valor de uma faixa do histograma
+unsigned long histogramBucketValue(int bucket)
+{
+    if (bucket < HIST_SUB)
+        return bucket;
+    int shift = bucket / HIST_SUB - 1;
+    return (unsigned long)(HIST_SUB + bucket % HIST_SUB) << shift;
+}
+
+// Retorna os dados de rastreamento da thread atual, registrando-a na primeira chamada. Um registro de uma
+// geração anterior já foi liberado por destroyScheduler e é substituído sem ser acessado
+ThreadTrace *threadTrace()
+{
+    unsigned generation = atomic_load_explicit(&trace_generation, memory_order_relaxed);
+    if (!current_trace || current_trace_generation != generation)
+    {
+        current_trace_generation = generation;
+        current_trace = (ThreadTrace *)calloc(1, sizeof(ThreadTrace));
+        pthread_mutex_lock(&scheduler.mutex);
+        current_trace->tid = scheduler.traces_count++;
+        current_trace->next = scheduler.traces;
+        scheduler.traces = current_trace;
+        pthread_mutex_unlock(&scheduler.mutex);
+    }
+    return current_trace;
+}
+
+// Registra a duração de uma etapa no histograma da thread atual
+void traceStage(int stage, long duration_ns)
+{
+    Histogram *hist = &threadTrace()->stages[stage];
+    unsigned long value = duration_ns > 0 ? (unsigned long)duration_ns : 0;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max)
+        hist->max = value;
+    hist->buckets[histogramBucket(value)]++;
+}
+
+// Registra um evento do ciclo de vida de uma tarefa na thread atual
+void traceEvent(const char *name, int async, int id, long ts_ns, long dur_ns)
+{
+    ThreadTrace *trace = threadTrace();
+    if (trace->events_count == trace->events_capacity)
+    {
+        trace->events_capacity = trace->events_capacity ? 2 * trace->events_capacity : 1024;
+        trace->events = (TraceEvent *)realloc(trace->events, trace->events_capacity * sizeof(TraceEvent));
+    }
+    trace->events[trace->events_count++] = (TraceEvent){name, async, id, ts_ns, dur_ns};
+}
+#endif
+
+// Retorna o slot de um ID cujo bloco está vivo, ou NULL. O bloco não é reciclado até unpinSlot, então o slot pode ser
+// travado e conferido mesmo que outra thread libere o último resultado do bloco nesse meio tempo
+ResultSlot *pinSlot(int id)
+{
+    pthread_mutex_lock(&scheduler.mutex);
+    SlotChunk *chunk = chunkForId(id);
+    if (chunk)
+        chunk->users++;
+    pthread_mutex_unlock(&scheduler.mutex);
+    return chunk ? &chunk->slots[id % SLOT_CHUNK] : NULL;
+}
+
+// Encerra o uso de um slot obtido com pinSlot, liberando também o seu resultado se collected
+void unpinSlot(ResultSlot *slot, int collected)
+{
+    pthread_mutex_lock(&scheduler.mutex);
+    releaseChunk(slot->chunk, collected, 1);
+    pthread_mutex_unlock(&scheduler.mutex);
+}
+
+// Libera o slot de um resultado obtido ou descartado, reciclando o bloco quando todos os seus resultados foram liberados
+void releaseSlot(ResultSlot *slot)
+{
+    pthread_mutex_lock(&scheduler.mutex);
+    releaseChunk(slot->chunk, 1, 0);
+    pthread_mutex_unlock(&scheduler.mutex);
+}
+
+void enqueueTask(ResultSlot *slot);
+
+// Executa uma tarefa (ou a descarta se o prazo expirou) e publica o resultado no slot do ID,
+// acordando apenas quem espera por ele e enfileirando as tarefas dependentes que ficaram prontas
+void runTask(ResultSlot *slot)
+{
+    ClassStats *stats = &scheduler.stats[slot->task.priority];
+    long now = nowNs();
+    long wait = now - slot->enqueue_ns;
+
+    atomic_fetch_add_explicit(&stats->wait_ns, wait, memory_order_relaxed);
+    long max = atomic_load_explicit(&stats->max_wait_ns, memory_order_relaxed);
+    while (wait > max && !atomic_compare_exchange_weak_explicit(&stats->max_wait_ns, &max, wait,
+                                                                memory_order_relaxed, memory_order_relaxed))
+        ;
+
+#if SCHED_TRACE
+    slot->end_ns = 0; // Tarefas expiradas ou sem rastreamento não registram a coleta
+#endif
+    void *result = NULL;
+    int expired = slot->task.deadline_ns != 0 && now > slot->task.deadline_ns;
+    if (expired)
+        atomic_fetch_add_explicit(&stats->expired, 1, memory_order_relaxed);
+    else
+    {
+#if SCHED_TRACE
+        // As opções lidas na retirada valem para a tarefa toda: ligar o rastreamento no meio não usa dequeue_ns velho
+        int tracing = slot->trace_flags;
+        if (tracing)
+            slot->start_ns = nowNs();
+#endif
+        if (slot->task.funexec_inputs)
+            result = slot->task.funexec_inputs(slot->task.args, slot->task.inputs, slot->task.num_inputs);
+        else
+            result = slot->task.funexec(slot->task.args);
+        atomic_fetch_add_explicit(&stats->executed, 1, memory_order_relaxed);
+#if SCHED_TRACE
+        if (tracing)
+        {
+            slot->end_ns = nowNs();
+            if (tracing & TRACE_HISTOGRAMS)
+            {
+                traceStage(STAGE_QUEUE, slot->dequeue_ns - slot->enqueue_ns);
+                traceStage(STAGE_START, slot->start_ns - slot->dequeue_ns);
+                traceStage(STAGE_EXEC, slot->end_ns - slot->start_ns);
+            }
+            if (tracing & TRACE_EVENTS)
+            {
+                traceEvent("fila", 1, slot->task.id, slot->enqueue_ns, slot->dequeue_ns - slot->enqueue_ns);
+                traceEvent("execução", 0, slot->task.id, slot->start_ns, slot->end_ns - slot->start_ns);
+            }
+        }
+#endif
+    }
+    if (slot->task.inputs != slot->inline_inputs)
+        free(slot->task.inputs);
+
+    pthread_mutex_lock(&slot->mutex);
+    slot->result = result;
+    slot->expired = expired;
+    slot->state = slot->detached ? SLOT_FREE : SLOT_READY;
+    int detached = slot->detached;
+    Dependent *dependents = slot->dependents;
+    slot->dependents = NULL;
+    pthread_cond_broadcast(&slot->cond);
+    pthread_mutex_unlock(&slot->mutex);
+
+    // Entrega o resultado às tarefas dependentes e enfileira as que não esperam mais nada
+    while (dependents)
+    {
+        Dependent *edge = dependents;
+        dependents = edge->next;
+        edge->slot->task.inputs[edge->index] = result;
+        if (atomic_fetch_sub_explicit(&edge->slot->deps_remaining, 1, memory_order_acq_rel) == 1)
+        {
+            edge->slot->enqueue_ns = nowNs();
+            enqueueTask(edge->slot);
+        }
+        free(edge);
+    }
+
+    if (detached)
+        releaseSlot(slot);
+}
+
+// Retira uma tarefa da fila de injeção de uma classe de prioridade, se houver
+ResultSlot *takeInjected(int priority)
+{
+    InjectionQueue *queue = &scheduler.queues[priority];
+    if (atomic_load_explicit(&queue->count, memory_order_relaxed) == 0)
+        return NULL;
+
+    ResultSlot *slot = NULL;
+    pthread_mutex_lock(&scheduler.mutex);
+    if (queue->count > 0)
+    {
+        slot = queue->buffer[queue->head];
+        queue->head = (queue->head + 1) % scheduler.buffer_size;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&scheduler.mutex);
+    return slot;
+}
+
+// Procura uma tarefa em ordem de prioridade: fila de alta prioridade e, para as classes normal e baixa, deque local,
+// fila de injeção e roubo das outras trabalhadoras
+ResultSlot *findTask(Worker *self)
+{
+    ResultSlot *slot = takeInjected(PRIORITY_HIGH);
+    for (int p = PRIORITY_NORMAL; !slot && p < NUM_PRIORITIES; p++)
+    {
+        slot = dequeTake(localDeque(self, p));
+        if (!slot)
+            slot = takeInjected(p);
+        for (int i = 1; !slot && i < N; i++)
+            slot = dequeSteal(localDeque(&scheduler.workers[(self->index + i) % N], p));
+    }
+
+    if (slot)
+    {
+        atomic_fetch_sub(&scheduler.pending, 1);
+#if SCHED_TRACE
+        slot->trace_flags = tracingFlags();
+        if (slot->trace_flags)
+            slot->dequeue_ns = nowNs();
+#endif
+    }
+    return slot;
+}
+
+// Avisa as trabalhadoras ociosas que uma nova tarefa foi enfileirada
+void notifyWorkers()
+{
+    atomic_fetch_add(&scheduler.pending, 1);
+    if (atomic_load(&scheduler.idle_workers) > 0)
+    {
+        pthread_mutex_lock(&scheduler.mutex);
+        pthread_cond_signal(&scheduler.work_cond);
+        pthread_mutex_unlock(&scheduler.mutex);
+    }
+}
+
+// Função executada por cada thread trabalhadora, que busca e executa tarefas até o escalonador ser destruído
+void *worker(void *arg)
+{
+    Worker *self = (Worker *)arg;
+    current_worker = self;
+
+    while (1)
+    {
+        ResultSlot *slot = findTask(self);
+        if (slot)
+        {
+            runTask(slot);
+            continue;
+        }
+
+        pthread_mutex_lock(&scheduler.mutex);
+        // Aguarda até que haja tarefas enfileiradas ou o escalonador seja destruído
+        atomic_fetch_add(&scheduler.idle_workers, 1);
+        while (atomic_load(&scheduler.pending) <= 0 && !scheduler.shutdown)
+            pthread_cond_wait(&scheduler.work_cond, &scheduler.mutex);
+        atomic_fetch_sub(&scheduler.idle_workers, 1);
+        int done = scheduler.shutdown && atomic_load(&scheduler.pending) <= 0;
+        pthread_mutex_unlock(&scheduler.mutex);
+
+        if (done)
+            break;
+    }
+
+    return NULL;
+}
+
+// Inicializa o escalonador e cria as threads trabalhadoras
 void initScheduler(int buffer_size)
 {
-    scheduler.buffer = (Task *)calloc(buffer_size, sizeof(Task));
     scheduler.buffer_size = buffer_size;
-    scheduler.buffer_count = 0;
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        scheduler.queues[p].buffer = (ResultSlot **)calloc(buffer_size, sizeof(ResultSlot *));
+        scheduler.queues[p].head = 0;
+        atomic_init(&scheduler.queues[p].count, 0);
+        pthread_cond_init(&scheduler.queues[p].not_full, NULL);
+        atomic_init(&scheduler.stats[p].executed, 0);
+        atomic_init(&scheduler.stats[p].expired, 0);
+        atomic_init(&scheduler.stats[p].wait_ns, 0);
+        atomic_init(&scheduler.stats[p].max_wait_ns, 0);
+    }
     scheduler.next_id = 0;
-    scheduler.results_count = 0;
-    scheduler.results = (Result *)calloc(N * buffer_size, sizeof(Result));
+    // Tabela inicial comporta N * buffer_size resultados pendentes com ocupação de no máximo metade antes de crescer
+    scheduler.chunks_min_size = 4;
+    while (scheduler.chunks_min_size * SLOT_CHUNK < 2 * N * buffer_size)
+        scheduler.chunks_min_size *= 2;
+    scheduler.chunks_size = scheduler.chunks_min_size;
+    scheduler.chunks = (SlotChunk **)calloc(scheduler.chunks_size, sizeof(SlotChunk *));
+    scheduler.chunks_count = 0;
+    scheduler.free_chunks = NULL;
+    scheduler.free_chunks_count = 0;
+    atomic_init(&scheduler.pending, 0);
+    atomic_init(&scheduler.idle_workers, 0);
+    scheduler.shutdown = 0;
+#if SCHED_TRACE
+    atomic_init(&scheduler.tracing, 0);
+    scheduler.traces = NULL;
+    scheduler.traces_count = 0;
+#endif
     pthread_mutex_init(&scheduler.mutex, NULL);
-    pthread_cond_init(&scheduler.cond, NULL);
-    pthread_cond_init(&scheduler.result_cond, NULL);
+    pthread_cond_init(&scheduler.work_cond, NULL);
+
+    for (int i = 0; i < N; i++)
+    {
+        Worker *w = &scheduler.workers[i];
+        w->index = i;
+        for (int p = PRIORITY_NORMAL; p < NUM_PRIORITIES; p++)
+        {
+            atomic_init(&localDeque(w, p)->top, 0);
+            atomic_init(&localDeque(w, p)->bottom, 0);
+        }
+        pthread_create(&w->thread, NULL, worker, w);
+    }
 }
 
-// Destroi o escalonador e libera memória
+// Destroi o escalonador: espera as tarefas enfileiradas terminarem, encerra as trabalhadoras e libera memória
 void destroyScheduler()
 {
-    free(scheduler.buffer);
-    free(scheduler.results);
+    pthread_mutex_lock(&scheduler.mutex);
+    scheduler.shutdown = 1;
+    pthread_cond_broadcast(&scheduler.work_cond);
+    pthread_mutex_unlock(&scheduler.mutex);
+
+    for (int i = 0; i < N; i++)
+        pthread_join(scheduler.workers[i].thread, NULL);
+
+    for (int i = 0; i < scheduler.chunks_size; i++)
+        if (scheduler.chunks[i])
+            freeChunk(scheduler.chunks[i]);
+    while (scheduler.free_chunks)
+    {
+        SlotChunk *chunk = scheduler.free_chunks;
+        scheduler.free_chunks = chunk->next;
+        freeChunk(chunk);
+    }
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        free(scheduler.queues[p].buffer);
+        pthread_cond_destroy(&scheduler.queues[p].not_full);
+    }
+    free(scheduler.chunks);
+#if SCHED_TRACE
+    // Os dados de rastreamento são liberados aqui. A nova geração faz as threads que continuarem vivas descartarem o
+    // ponteiro antigo e se registrarem de novo no próximo rastreamento
+    atomic_fetch_add(&trace_generation, 1);
+    while (scheduler.traces)
+    {
+        ThreadTrace *trace = scheduler.traces;
+        scheduler.traces = trace->next;
+        free(trace->events);
+        free(trace);
+    }
+#endif
     pthread_mutex_destroy(&scheduler.mutex);
-    pthread_cond_destroy(&scheduler.cond);
-    pthread_cond_destroy(&scheduler.result_cond);
+    pthread_cond_destroy(&scheduler.work_cond);
 }
 
-// Agenda uma execução de função e retorna o ID atribuído, e espera se o buffer estiver cheio
-int scheduleExecution(void *(*funexec)(void *), void *args)
+// Reserva o slot de um novo ID, alocando um novo bloco no primeiro ID de cada bloco.
+// Os IDs voltam a 0 depois de INT_MAX; um bloco cujo intervalo de IDs ainda está vivo desde a volta anterior é pulado
+ResultSlot *newTask(Task task, long now)
 {
     pthread_mutex_lock(&scheduler.mutex);
+    int id = (int)(scheduler.next_id++ & INT_MAX);
+    while (id % SLOT_CHUNK == 0 && chunkForId(id))
+    {
+        scheduler.next_id += SLOT_CHUNK;
+        id = (int)((scheduler.next_id - 1) & INT_MAX);
+    }
+    if (id % SLOT_CHUNK == 0)
+        allocChunk(id);
+    ResultSlot *slot = &chunkForId(id)->slots[id % SLOT_CHUNK];
+    pthread_mutex_unlock(&scheduler.mutex);
 
-    while (scheduler.buffer_count == scheduler.buffer_size)
-        pthread_cond_wait(&scheduler.cond, &scheduler.mutex);
+    pthread_mutex_lock(&slot->mutex);
+    task.id = id;
+    slot->task = task;
+    slot->state = SLOT_PENDING;
+    slot->expired = 0;
+    slot->detached = 0;
+    slot->enqueue_ns = now;
+    slot->dependents = NULL;
+    pthread_mutex_unlock(&slot->mutex);
 
-    Task task = {.id = scheduler.next_id++, .funexec = funexec, .args = args};
+    return slot;
+}
 
-    scheduler.buffer[scheduler.buffer_count++] = task;
+// Coloca uma tarefa pronta em uma fila.
+// Fora das trabalhadoras, espera se a fila de injeção estiver cheia; dentro delas, a tarefa vai para a deque local da classe
+void enqueueTask(ResultSlot *slot)
+{
+    int priority = slot->task.priority;
 
-    pthread_cond_broadcast(&scheduler.cond); // Notifica a thread do dispatcher
+    if (current_worker && priority != PRIORITY_HIGH && dequePush(localDeque(current_worker, priority), slot))
+    {
+        notifyWorkers();
+        return;
+    }
+
+    InjectionQueue *queue = &scheduler.queues[priority];
+    pthread_mutex_lock(&scheduler.mutex);
+    if (current_worker && queue->count == scheduler.buffer_size)
+    {
+        // Deque local e fila de injeção cheias: executa a subtarefa na própria trabalhadora
+        pthread_mutex_unlock(&scheduler.mutex);
+#if SCHED_TRACE
+        slot->trace_flags = tracingFlags();
+        if (slot->trace_flags)
+            slot->dequeue_ns = nowNs();
+#endif
+        runTask(slot);
+        return;
+    }
+
+    while (queue->count == scheduler.buffer_size)
+        pthread_cond_wait(&queue->not_full, &scheduler.mutex);
+
+    int tail = (queue->head + queue->count) % scheduler.buffer_size;
+    queue->buffer[tail] = slot;
+    queue->count++;
     pthread_mutex_unlock(&scheduler.mutex);
 
-    return task.id;
+    notifyWorkers();
 }
 
-// Função executada por cada thread trabalhadora, para executar as funções do buffer
-void *worker(void *arg)
+// Agenda uma execução de função com prioridade e prazo relativo em milissegundos (0 = sem prazo) e retorna o ID
+// atribuído, ou -1 se a prioridade for inválida
+int scheduleExecutionWithOptions(void *(*funexec)(void *), void *args, int priority, long deadline_ms)
 {
-    Task task = *(Task *)arg;
+    if (priority < 0 || priority >= NUM_PRIORITIES)
+        return -1;
 
-    int *result = (int *)task.funexec(task.args);
+    long now = nowNs();
+    long deadline_ns = deadline_ms > 0 ? now + deadline_ms * 1000000L : 0;
+    ResultSlot *slot = newTask((Task){.funexec = funexec, .args = args, .priority = priority, .deadline_ns = deadline_ns}, now);
 
-    pthread_mutex_lock(&scheduler.mutex);
-    scheduler.results[scheduler.results_count++] = (Result){.id = task.id, .result = *result};
-    pthread_cond_broadcast(&scheduler.result_cond);
-    pthread_mutex_unlock(&scheduler.mutex);
-
-    free(result);
-    return NULL;
+    int id = slot->task.id;
+    enqueueTask(slot);
+    return id;
 }
 
-// Função que distribui tarefas entre as threads
-void *dispatcher(void *arg)
+// Agenda uma execução que depende dos IDs em deps e retorna o ID atribuído. A função é chamada com os argumentos e
+// os resultados das dependências (NULL para dependências expiradas ou que não estão vivas), assim que todas terminarem
+int scheduleExecutionAfter(void *(*funexec)(void *, void **, int), void *args, const int *deps, int num_deps)
 {
-    pthread_t workers[N];
+    ResultSlot *slot = newTask((Task){.funexec_inputs = funexec, .args = args, .priority = PRIORITY_NORMAL}, nowNs());
+    int id = slot->task.id;
 
-    int i = 0;
-    while (1)
+    slot->task.num_inputs = num_deps;
+    slot->task.inputs = num_deps <= INLINE_INPUTS ? slot->inline_inputs : (void **)malloc(num_deps * sizeof(void *));
+    // A contagem começa com uma unidade extra para a tarefa não ser enfileirada antes de todas as arestas existirem
+    atomic_store(&slot->deps_remaining, num_deps + 1);
+
+    for (int i = 0; i < num_deps; i++)
     {
-        pthread_mutex_lock(&scheduler.mutex);
-        // Aguarda até que haja tarefas no buffer ou todas as threads estejam ocupadas
-        while (scheduler.buffer_count == 0)
-            pthread_cond_wait(&scheduler.cond, &scheduler.mutex);
+        ResultSlot *dep = pinSlot(deps[i]);
+        slot->task.inputs[i] = NULL;
+        if (!dep)
+        {
+            atomic_fetch_sub(&slot->deps_remaining, 1);
+            continue;
+        }
 
-        pthread_create(&workers[i], NULL, worker, &scheduler.buffer[--scheduler.buffer_count]);
-        pthread_detach(workers[i++]);
-        pthread_mutex_unlock(&scheduler.mutex);
-        // Aguarda até que todas as threads tenham sido criadas e executadas
-        if (i == N)
-            i = 0;
+        pthread_mutex_lock(&dep->mutex);
+        if (dep->task.id != deps[i] || dep->state == SLOT_FREE)
+            atomic_fetch_sub(&slot->deps_remaining, 1);
+        else if (dep->state == SLOT_PENDING)
+        {
+            Dependent *edge = (Dependent *)malloc(sizeof(Dependent));
+            *edge = (Dependent){.slot = slot, .index = i, .next = dep->dependents};
+            dep->dependents = edge;
+        }
+        else
+        {
+            slot->task.inputs[i] = dep->result;
+            atomic_fetch_sub(&slot->deps_remaining, 1);
+        }
+        pthread_mutex_unlock(&dep->mutex);
+        unpinSlot(dep, 0);
     }
 
-    return NULL;
+    if (atomic_fetch_sub_explicit(&slot->deps_remaining, 1, memory_order_acq_rel) == 1)
+        enqueueTask(slot);
+    return id;
 }
 
-// Troca um resultado com a última posição no array para facilitar a remoção
-void swapWithLastPosition(Result arr[], int pos, int size)
+// Agenda uma execução de função com prioridade normal e sem prazo, e retorna o ID atribuído
+int scheduleExecution(void *(*funexec)(void *), void *args)
 {
-    Result temp = arr[pos];
-    arr[pos] = arr[size - 1];
-    arr[size - 1] = temp;
+    return scheduleExecutionWithOptions(funexec, args, PRIORITY_NORMAL, 0);
 }
 
-// Obtém o resultado da execução de uma tarefa com base no ID
-int getExecutionResult(int id)
+// Retorna o slot de um ID vivo, fixado com pinSlot e com o mutex do slot travado, ou NULL se o ID não foi agendado,
+// seu resultado já foi obtido ou descartado. Um ID livre pode estar em um bloco vivo, então o slot precisa ser conferido
+ResultSlot *lockLiveSlot(int id)
 {
-    Result result;
-    int has_id = 0;
+    ResultSlot *slot = pinSlot(id);
+    if (!slot)
+        return NULL;
 
-    while (!has_id)
+    pthread_mutex_lock(&slot->mutex);
+    if (slot->state == SLOT_FREE || slot->task.id != id || slot->detached)
     {
-        pthread_mutex_lock(&scheduler.mutex);
+        pthread_mutex_unlock(&slot->mutex);
+        unpinSlot(slot, 0);
+        return NULL;
+    }
+    return slot;
+}
+
+// Obtém o resultado da execução de uma tarefa com base no ID e informa em status (se não for NULL)
+// se ela foi executada, expirou ou se o ID não está vivo
+void *getExecutionResultStatus(int id, int *status)
+{
+    ResultSlot *slot = lockLiveSlot(id);
+    if (!slot)
+    {
+        if (status)
+            *status = EXECUTION_UNKNOWN;
+        return NULL;
+    }
+
+    int misses = 0;
+    while (slot->state == SLOT_PENDING)
+    {
+        if (!current_worker)
+        {
+            pthread_cond_wait(&slot->cond, &slot->mutex);
+            continue;
+        }
 
-        for (int i = 0; i < scheduler.results_count; i++)
-            if (scheduler.results[i].id == id)
+        // Trabalhadoras executam outras tarefas enquanto o resultado não fica pronto. Sem tarefas, cedem a CPU algumas
+        // vezes e depois dormem no slot: o resultado as acorda na hora, e o sono curto as faz voltar a procurar tarefas
+        pthread_mutex_unlock(&slot->mutex);
+        ResultSlot *other = findTask(current_worker);
+        if (other)
+        {
+            runTask(other);
+            misses = 0;
+        }
+        else if (++misses < HELP_SPIN)
+            sched_yield();
+        pthread_mutex_lock(&slot->mutex);
+
+        if (!other && misses >= HELP_SPIN && slot->state == SLOT_PENDING)
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += HELP_WAIT_NS;
+            if (until.tv_nsec >= 1000000000L)
             {
-                has_id = 1;
-                result = scheduler.results[i];
-                swapWithLastPosition(scheduler.results, i, scheduler.results_count);
-                scheduler.results_count--;
-                break;
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000L;
             }
+            pthread_cond_timedwait(&slot->cond, &slot->mutex, &until);
+        }
+    }
 
-        if (!has_id)
-            pthread_cond_wait(&scheduler.result_cond, &scheduler.mutex);
+    // Outro chamador obteve ou descartou o mesmo ID enquanto esperávamos
+    if (slot->state != SLOT_READY || slot->task.id != id)
+    {
+        pthread_mutex_unlock(&slot->mutex);
+        unpinSlot(slot, 0);
+        if (status)
+            *status = EXECUTION_UNKNOWN;
+        return NULL;
+    }
 
-        pthread_mutex_unlock(&scheduler.mutex);
+    void *result = slot->result;
+    if (status)
+        *status = slot->expired ? EXECUTION_EXPIRED : EXECUTION_DONE;
+    slot->state = SLOT_FREE;
+#if SCHED_TRACE
+    int tracing = tracingFlags();
+    if (tracing && slot->end_ns)
+    {
+        long now = nowNs();
+        if (tracing & TRACE_HISTOGRAMS)
+            traceStage(STAGE_PICKUP, now - slot->end_ns);
+        if (tracing & TRACE_EVENTS)
+            traceEvent("coleta", 1, id, slot->end_ns, now - slot->end_ns);
+    }
+#endif
+    pthread_mutex_unlock(&slot->mutex);
+
+    unpinSlot(slot, 1);
+    return result;
+}
+
+// Obtém o resultado da execução de uma tarefa com base no ID, ou NULL se o ID não estiver vivo ou a tarefa expirou
+void *getExecutionResult(int id)
+{
+    return getExecutionResultStatus(id, NULL);
+}
+
+// Descarta o resultado de um ID sem esperar por ele; o slot é liberado assim que a tarefa terminar
+void discardExecutionResult(int id)
+{
+    ResultSlot *slot = lockLiveSlot(id);
+    if (!slot)
+        return;
+
+    int ready = slot->state == SLOT_READY;
+    if (ready)
+        slot->state = SLOT_FREE;
+    else
+        slot->detached = 1;
+    pthread_mutex_unlock(&slot->mutex);
+
+    unpinSlot(slot, ready);
+}
+
+// Imprime as métricas de cada classe de prioridade
+void printSchedulerStats()
+{
+    const char *names[NUM_PRIORITIES] = {"alta", "normal", "baixa"};
+
+    for (int p = 0; p < NUM_PRIORITIES; p++)
+    {
+        ClassStats *stats = &scheduler.stats[p];
+        long executed = atomic_load(&stats->executed);
+        long expired = atomic_load(&stats->expired);
+        long taken = executed + expired;
+        printf("Prioridade %-6s: %ld executadas, %ld expiradas, espera média %.3f ms, espera máxima %.3f ms\n",
+               names[p], executed, expired,
+               taken ? atomic_load(&stats->wait_ns) / (double)taken / 1e6 : 0.0,
+               atomic_load(&stats->max_wait_ns) / 1e6);
+    }
+}
+
+#if SCHED_TRACE
+// Ativa ou desativa o rastreamento (combinação de TRACE_HISTOGRAMS e TRACE_EVENTS, 0 para desativar)
+void setTracing(int flags)
+{
+    atomic_store(&scheduler.tracing, flags);
+}
+
+// Retorna o percentil p (0 a 100) de um histograma, com a precisão da faixa
+unsigned long histogramPercentile(Histogram *hist, double p)
+{
+    unsigned long target = (unsigned long)(hist->count * p / 100.0);
+    unsigned long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++)
+    {
+        seen += hist->buckets[b];
+        if (seen > target)
+            return histogramBucketValue(b);
+    }
+    return hist->max;
+}
+
+// Imprime os histogramas de cada etapa, somando os de todas as threads.
+// Deve ser chamada sem tarefas em andamento (ex.: depois de coletar todos os resultados)
+void printTraceStats()
+{
+    const char *names[NUM_STAGES] = {"fila", "início", "execução", "coleta"};
+
+    for (int stage = 0; stage < NUM_STAGES; stage++)
+    {
+        Histogram total = {0};
+        for (ThreadTrace *trace = scheduler.traces; trace; trace = trace->next)
+        {
+            Histogram *hist = &trace->stages[stage];
+            total.count += hist->count;
+            total.sum += hist->sum;
+            if (hist->max > total.max)
+                total.max = hist->max;
+            for (int b = 0; b < HIST_BUCKETS; b++)
+                total.buckets[b] += hist->buckets[b];
+        }
+        printf("Etapa %s: %lu amostras, média %.3f ms, p50 %.3f ms, p99 %.3f ms, máx %.3f ms\n",
+               names[stage], total.count, total.count ? total.sum / (double)total.count / 1e6 : 0.0,
+               histogramPercentile(&total, 50) / 1e6, histogramPercentile(&total, 99) / 1e6, total.max / 1e6);
     }
+}
+
+// Grava os eventos registrados no formato JSON do Chrome e retorna 0, ou -1 se o arquivo não puder ser criado.
+// Deve ser chamada sem tarefas em andamento
+int dumpChromeTrace(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return -1;
 
-    return result.result;
+    int first = 1;
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (ThreadTrace *trace = scheduler.traces; trace; trace = trace->next)
+        for (int i = 0; i < trace->events_count; i++)
+        {
+            TraceEvent *ev = &trace->events[i];
+            double ts = ev->ts_ns / 1e3, dur = ev->dur_ns / 1e3;
+            if (ev->async)
+                fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"tarefa\",\"ph\":\"b\",\"id\":%d,\"ts\":%.3f,\"pid\":1,\"tid\":%d},\n"
+                              "{\"name\":\"%s\",\"cat\":\"tarefa\",\"ph\":\"e\",\"id\":%d,\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                        first ? "" : ",\n", ev->name, ev->id, ts, trace->tid, ev->name, ev->id, ts + dur, trace->tid);
+            else
+                fprintf(file, "%s{\"name\":\"%s %d\",\"cat\":\"tarefa\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                        first ? "" : ",\n", ev->name, ev->id, ts, dur, trace->tid);
+            first = 0;
+        }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return 0;
 }
+#endif
 
 // Função de exemplo para ser executada em uma thread
 void *example_function(void *arg)
 {
     int *value = (int *)arg;
-    int *result = (int *)malloc(sizeof(int));
-    *result = *value * 2;
     sleep(time(NULL) % 3 + 1);
-    return result;
+    return (void *)(intptr_t)(*value * 2);
+}
+
+// Função de exemplo para trabalho em lote
+void *bulk_function(void *arg)
+{
+    sleep(1);
+    return arg;
+}
+
+// Funções de exemplo para um grafo de dependências: valor inicial, dobro e soma das entradas
+void *dag_source(void *arg)
+{
+    return arg;
 }
 
-int main()
+void *dag_double(void *arg, void **inputs, int num_inputs)
+{
+    (void)arg;
+    (void)num_inputs;
+    return (void *)((intptr_t)inputs[0] * 2);
+}
+
+void *dag_sum(void *arg, void **inputs, int num_inputs)
+{
+    intptr_t sum = (intptr_t)arg;
+    for (int i = 0; i < num_inputs; i++)
+        sum += (intptr_t)inputs[i];
+    return (void *)sum;
+}
+
+// Intervalo de uma redução em árvore
+typedef struct
+{
+    int begin, end;
+} Range;
+
+// Função de exemplo fork-join: soma os inteiros de [begin, end) dividindo o intervalo em subtarefas
+void *tree_sum(void *arg)
+{
+    Range *range = (Range *)arg;
+
+    if (range->end - range->begin <= 64)
+    {
+        intptr_t sum = 0;
+        for (int i = range->begin; i < range->end; i++)
+            sum += i;
+        return (void *)sum;
+    }
+
+    int mid = range->begin + (range->end - range->begin) / 2;
+    Range left = {range->begin, mid}, right = {mid, range->end};
+    int left_id = scheduleExecution(tree_sum, &left);
+    int right_id = scheduleExecution(tree_sum, &right);
+    return (void *)((intptr_t)getExecutionResult(left_id) + (intptr_t)getExecutionResult(right_id));
+}
+
+int main(int argc, char *argv[])
 {
     initScheduler(10);
     srand(time(NULL));
-    // Criação da thread do dispatcher
-    pthread_t dispatcher_thread;
-    pthread_create(&dispatcher_thread, NULL, dispatcher, NULL);
+#if SCHED_TRACE
+    // Rastreamento opcional: ./ex5 <arquivo.json>
+    const char *trace_path = argc > 1 ? argv[1] : NULL;
+    if (trace_path)
+        setTracing(TRACE_HISTOGRAMS | TRACE_EVENTS);
+#else
+    (void)argc;
+    (void)argv;
+#endif
 
     int args[10];
     int ids[10];
@@ -196,14 +1281,53 @@ int main()
     // Coleta resultados
     for (int i = 0; i < 10; i++)
     {
-        int result = getExecutionResult(ids[i]);
+        int result = (int)(intptr_t)getExecutionResult(ids[i]);
         printf("Execução %d resultado: %d\n", ids[i], result);
     }
 
+    // Redução em árvore usando subtarefas
+    Range range = {0, 1000};
+    int sum_id = scheduleExecution(tree_sum, &range);
+    printf("Soma paralela de [0, 1000): %d\n", (int)(intptr_t)getExecutionResult(sum_id));
+
+    // Grafo em diamante: a = 10, b = 2a, c = a + 1, d = b + c
+    int a = scheduleExecution(dag_source, (void *)(intptr_t)10);
+    int b = scheduleExecutionAfter(dag_double, NULL, &a, 1);
+    int c = scheduleExecutionAfter(dag_sum, (void *)(intptr_t)1, &a, 1);
+    int bc[2] = {b, c};
+    int d = scheduleExecutionAfter(dag_sum, NULL, bc, 2);
+    discardExecutionResult(a);
+    discardExecutionResult(b);
+    discardExecutionResult(c);
+    printf("Resultado do grafo de dependências: %d\n", (int)(intptr_t)getExecutionResult(d));
+
+    // Trabalho em lote ocupando as trabalhadoras, seguido de tarefas com prazo
+    int bulk_ids[2 * N];
+    for (int i = 0; i < 2 * N; i++)
+        bulk_ids[i] = scheduleExecutionWithOptions(bulk_function, NULL, PRIORITY_LOW, 0);
+    int urgent_id = scheduleExecutionWithOptions(example_function, &args[0], PRIORITY_HIGH, 5000);
+    int late_id = scheduleExecutionWithOptions(example_function, &args[1], PRIORITY_LOW, 100);
+
+    int status;
+    int urgent = (int)(intptr_t)getExecutionResultStatus(urgent_id, &status);
+    printf("Execução urgente %d resultado: %d (%s)\n", urgent_id, urgent, status == EXECUTION_DONE ? "executada" : "expirada");
+    getExecutionResultStatus(late_id, &status);
+    printf("Execução com prazo curto %d: %s\n", late_id, status == EXECUTION_DONE ? "executada" : "expirada");
+    for (int i = 0; i < 2 * N; i++)
+        getExecutionResult(bulk_ids[i]);
+
+    printSchedulerStats();
+#if SCHED_TRACE
+    if (trace_path)
+    {
+        printTraceStats();
+        if (dumpChromeTrace(trace_path) == 0)
+            printf("Rastreamento gravado em %s\n", trace_path);
+    }
+#endif
+
     // Finaliza o programa
-    pthread_cancel(dispatcher_thread);     // Iniciar o cancelamento da thread do dispatcher
-    pthread_join(dispatcher_thread, NULL); // Aguardar o término da thread do dispatcher
     destroyScheduler();
 
     pthread_exit(NULL);
-}
\ No newline at end of file
+}
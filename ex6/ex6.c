@@ -1,135 +1,1074 @@
+#define _GNU_SOURCE // pthread_rwlockattr_setkind_np
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <time.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <getopt.h>
 
-#define ARRAY_SIZE 10
+#define ARRAY_SIZE 10 // Tamanho padrão do array, pode ser alterado pelo segundo argumento do programa
+#define PRINT_LIMIT 10 // Número máximo de posições impressas por leitura
 #define NUM_READERS 3
 #define NUM_WRITERS 2
+#define WRITE_BATCH 3  // Posições alteradas por cada escritor da demonstração em uma única escrita
 
-int array[ARRAY_SIZE];
+#define CACHE_LINE 64
+#define PF_RINC 0x100            // Incremento de leitor em rin/rout (os 8 bits baixos são do escritor)
+#define PF_WBITS 0x3             // Bits de escritor em rin: presente e fase
+#define PF_PRES 0x2              // Escritor presente
+#define PF_PHID 0x1              // Fase do escritor (paridade do ticket)
+#define PF_WRITER_SLOTS 64       // Palavras de espera dos escritores, indexadas por ticket
+#define PF_SPIN 200              // Iterações de espera ativa antes de dormir no futex
+#define BRAVO_SLOTS 128          // Slots de leitores por lock BRAVO
+#define BRAVO_INHIBIT_FACTOR 9   // Após uma revogação, o fast path fica desligado por 9x o tempo que ela levou
+#define STRIPE_CELLS 64          // Posições consecutivas protegidas por uma mesma faixa (stripe)
+#define STRIPE_OPTIMISTIC_TRIES 4 // Tentativas de leitura otimista antes de travar as faixas
+#define EBR_MAX_THREADS 256      // Número máximo de threads leitoras simultâneas na reclamação por épocas
+#define HIST_SUB_BITS 4          // Sub-faixas por potência de 2 nos histogramas do benchmark (precisão de ~6%)
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+// As células são atômicas para que as estratégias otimistas possam lê-las sem lock
+atomic_int *array;
+int array_size = ARRAY_SIZE;
 
 /*
-Nossa dupla utilizou Lamport's Bakery Algorithm para garantir a ordem justa entre escritores,
-em que um escritor recebe um ticket e espera até que seja a sua vez de escrever. Acreditamos
-que essa abordagem é mais justa para evitar starvation de escritores, garantindo que todos os
-escritores terão a chance de escrever, mesmo que haja muitos leitores ativos.
+Nossa dupla utilizou inicialmente Lamport's Bakery Algorithm para garantir a ordem justa entre
+escritores, em que um escritor recebe um ticket e espera até que seja a sua vez de escrever.
+Acreditamos que essa abordagem é mais justa para evitar starvation de escritores, garantindo que
+todos os escritores terão a chance de escrever, mesmo que haja muitos leitores ativos.
+A primeira versão empilhava um mutex de tickets, um mutex de escrita e um mutex de leitura com
+três variáveis de condição, o que custava cinco operações de lock e dois broadcasts por escrita.
+Ela foi substituída por um único lock phase-fair de tickets (PF-T), que mantém a mesma ideia:
+- Escritores pegam um ticket (win) e entram em ordem (wout), sem starvation entre eles.
+- Leitores e escritores alternam fases: um leitor que chega com um escritor presente espera só
+  até o fim daquela escrita, e um escritor espera só os leitores que já estavam dentro. Assim
+  nenhum dos lados passa fome.
+- A espera é feita em futex e acorda apenas quem pode prosseguir: todos os leitores bloqueados
+  pela escrita que terminou, ou o escritor do próximo ticket.
 Nossas Referências:
 - Vimos a respeito deste algoritmo em algumas fontes antes de implementar. Nos baseamos em
 mais de uma, mas especialmente, nas implementações do link abaixo:
 https://www.geeksforgeeks.org/bakery-algorithm-in-process-synchronization/
 - Link do artigo original: https://lamport.azurewebsites.net/pubs/bakery.pdf
+- Lock phase-fair: B. Brandenburg e J. Anderson, "Spin-Based Reader-Writer Synchronization for
+  Multiprocessor Real-Time Systems", Real-Time Systems, 2010.
+
+O acesso ao array é feito por uma estratégia, escolhida pelo primeiro argumento do programa:
+- phasefair (padrão): o lock phase-fair de tickets descrito acima.
+- seqlock: leitores copiam o array sem escrever em nenhuma variável compartilhada e repetem a cópia
+  se o número de sequência mudou durante a leitura; escritores continuam serializados por um mutex
+  e deixam o número de sequência ímpar enquanto escrevem. Como os leitores não disputam nenhuma
+  linha de cache, a vazão de leitura cresce com o número de núcleos.
+- bravo: um lock leitor-escritor BRAVO (Biased Locking for Reader-Writer Locks, Dice e Kogan,
+  USENIX ATC 2019). Cada thread tem um slot de leitor próprio, em sua própria linha de cache.
+  Enquanto o lock está enviesado para leitura, um leitor apenas marca o seu slot. O escritor
+  revoga o viés, espera os slots esvaziarem e usa um pthread_rwlock por baixo. Revogações
+  frequentes desligam o viés por um tempo proporcional ao custo delas.
+- striped: o array é dividido em faixas de STRIPE_CELLS posições, cada uma com seu mutex de
+  escrita e seu número de versão (um seqlock por faixa). Escritores em faixas diferentes
+  escrevem em paralelo. Uma leitura de um intervalo guarda as versões das faixas envolvidas,
+  copia e confere se nenhuma mudou; após STRIPE_OPTIMISTIC_TRIES falhas, trava as faixas em
+  ordem crescente e copia, o que garante uma cópia consistente mesmo com muitos escritores.
+- rcu: cada escrita copia a versão atual do array, altera a cópia e a publica com uma troca
+  atômica de ponteiro. Leitores carregam o ponteiro e leem a versão que encontraram, sem nunca
+  esperar; escritores só esperam outros escritores. Versões antigas são liberadas por reclamação
+  baseada em épocas (EBR): cada leitor anuncia a época global em que entrou, a época só avança
+  quando todos os leitores ativos a alcançaram, e uma versão aposentada na época e é liberada
+  quando a época global chega a e + 2, quando nenhum leitor pode mais enxergá-la. Como cada
+  escrita copia o array inteiro, a estratégia é indicada para arrays pequenos e leitura intensa.
+Todas as estratégias oferecem as mesmas duas operações:
+- Leitura de um intervalo [início, início + quantidade): a cópia é consistente, ou seja, reflete
+  o array em um único instante entre escritas.
+- Escrita em lote: uma lista de pares (posição, valor) aplicada atomicamente, com uma única
+  aquisição de escrita. Nenhum leitor vê parte do lote aplicada, e o custo de sincronização é
+  pago uma vez por lote em vez de uma vez por posição. Na striped, o lote trava de uma vez, em
+  ordem crescente, apenas as faixas que contêm alguma das posições.
+Uso:
+  ./ex6 [estrategia] [tamanho do array]
+      Demonstração: NUM_READERS leitores e NUM_WRITERS escritores imprimindo cada operação. Cada
+      escritor grava o mesmo valor em WRITE_BATCH posições de uma vez.
+  ./ex6 -b [-s estrategia|all] [-t threads] [-r %leitura] [-d segundos] [-n tamanho]
+           [-k posições por escrita] [-l posições por leitura] [-v] [-H]
+      Benchmark: cada thread sorteia leitura (com a probabilidade dada) ou escrita e mede a
+      latência de cada operação em um histograma log-linear próprio. Uma escrita é um lote de k
+      posições sorteadas (padrão 1) e uma leitura copia l posições a partir de um início sorteado
+      (padrão: o array inteiro). Ao final, imprime uma linha CSV por estratégia com a vazão, os
+      percentis de latência e a maior espera de um escritor (indicador de starvation). -H omite o
+      cabeçalho, para acumular resultados em um arquivo.
+      Com -v, cada escrita grava um único valor em um grupo de k posições consecutivas, e cada
+      leitura confere, fora do tempo medido, que todo grupo inteiro dentro do intervalo lido tem
+      um único valor. A coluna torn_reads conta as leituras que viram um lote pela metade, e o
+      programa termina com erro se alguma estratégia tiver uma.
 */
 
-// Mutexes e variáveis de condição
-pthread_mutex_t read_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Estratégia de sincronização do array: leitura consistente de um intervalo e escrita atômica de um lote.
+// As funções recebem argumentos já validados por array_read_range e array_write_batch (ou gerados válidos pelo benchmark)
+typedef struct {
+    const char *name;
+    void (*init)(void);    // Inicialização da estratégia, ou NULL se não houver
+    void (*destroy)(void); // Liberação dos recursos da estratégia, ou NULL se não houver
+    void (*read_range)(int start, int count, int *dest);
+    // Aplica values[i] em indices[i] para i < n, em ordem (a última escrita de uma posição repetida vence)
+    void (*write_batch)(const int *indices, const int *values, int n);
+} Strategy;
+
+// Histograma log-linear de latências em nanossegundos
+typedef struct {
+    unsigned long count;
+    unsigned long max;
+    unsigned long buckets[HIST_BUCKETS];
+} Histogram;
+
+// Estado de uma thread do benchmark
+typedef struct {
+    pthread_t thread;
+    unsigned seed;        // Semente de rand_r
+    int *buffer;          // Destino das leituras
+    int *indices;         // Posições do lote de escrita
+    int *values;          // Valores do lote de escrita
+    Histogram reads;      // Latências de leitura
+    Histogram writes;     // Latências de escrita
+    unsigned long torn;   // Leituras que viram um lote aplicado pela metade (com -v)
+} BenchThread;
+
+// Slot de leitor do lock BRAVO, ocupando uma linha de cache inteira para evitar falso compartilhamento
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int busy;
+} BravoSlot;
+
+// Faixa do array na estratégia striped, em sua própria linha de cache
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint version; // Ímpar enquanto um escritor altera a faixa
+    pthread_mutex_t mutex;                    // Serializa os escritores da faixa
+} Stripe;
+
+// Versão imutável do array publicada pela estratégia rcu
+typedef struct ArrayVersion {
+    struct ArrayVersion *next;    // Próxima versão na lista de aposentadas
+    unsigned long retire_epoch;   // Época global em que a versão foi substituída
+    int cells[];                  // Conteúdo do array nesta versão
+} ArrayVersion;
+
+// Registro de época de uma thread leitora: (época << 1) | 1 enquanto lê, 0 fora de leitura
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ulong state;
+    atomic_int in_use; // Registro pertence a uma thread viva
+} EbrRecord;
+
+// Lock leitor-escritor phase-fair de tickets
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint rin;  // Leitores que entraram (* PF_RINC) | bits do escritor
+    _Alignas(CACHE_LINE) atomic_uint rout; // Leitores que saíram (* PF_RINC)
+    _Alignas(CACHE_LINE) atomic_uint win;  // Próximo ticket de escritor
+    atomic_uint wout;                      // Ticket do escritor da vez
+    atomic_uint phase;                     // Incrementado ao fim de cada escrita (futex dos leitores)
+    atomic_int readers_sleeping;           // Leitores dormindo em phase
+    atomic_int writer_draining;            // Escritor dormindo em rout à espera dos leitores
+    atomic_int writers_sleeping;           // Escritores dormindo à espera do ticket
+    atomic_uint writer_slots[PF_WRITER_SLOTS]; // Futex de cada ticket (ticket % PF_WRITER_SLOTS)
+} PhaseFairLock;
+
+// Lock leitor-escritor BRAVO
+typedef struct {
+    BravoSlot slots[BRAVO_SLOTS];     // Slots de leitores do fast path
+    _Alignas(CACHE_LINE) atomic_int rbias; // Fast path de leitura habilitado
+    atomic_long inhibit_until;        // Instante (ns) até o qual o viés não pode ser religado
+    pthread_rwlock_t underlying;      // Lock usado no slow path e pelos escritores
+} BravoRWLock;
+
 pthread_mutex_t print_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t read_cond = PTHREAD_COND_INITIALIZER;
-pthread_cond_t write_cond = PTHREAD_COND_INITIALIZER;
-pthread_cond_t ticket_cond = PTHREAD_COND_INITIALIZER;
-int reader_count = 0;
-int writer_waiting = 0;
 
-// Sistema de tickets para garantir fairness entre escritores
-unsigned long next_ticket = 0;
-unsigned long current_ticket = 0;
-pthread_mutex_t ticket_mutex = PTHREAD_MUTEX_INITIALIZER;
+PhaseFairLock phasefair_lock; // Zerado é um lock livre
 
-void *reader(void *arg) {
-    int id = *(int *)arg;
-    free(arg);
+// Número de sequência do seqlock (ímpar durante uma escrita) e mutex que serializa os escritores
+atomic_uint seq = 0;
+pthread_mutex_t seq_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Índice de slot de leitor da thread atual, atribuído na primeira leitura
+static _Thread_local int thread_slot = -1;
+atomic_int next_thread_slot = 0;
+
+BravoRWLock bravo_lock;
+
+Stripe *stripes;
+int num_stripes;
+// Buffers da thread atual, que crescem conforme o maior uso: versões das faixas lidas em striped_read_range e
+// faixas travadas em striped_write_batch. As chaves liberam os buffers quando a thread termina
+static _Thread_local unsigned *stripe_versions;
+static _Thread_local int stripe_versions_capacity;
+static _Thread_local int *stripe_touched;
+static _Thread_local int stripe_touched_capacity;
+pthread_key_t stripe_versions_key;
+pthread_key_t stripe_touched_key;
+pthread_once_t stripe_keys_once = PTHREAD_ONCE_INIT;
+
+// Estado da estratégia rcu. A lista de aposentadas só é acessada com rcu_write_mutex travado
+_Atomic(ArrayVersion *) current_version;
+ArrayVersion *retired_versions = NULL;
+pthread_mutex_t rcu_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+atomic_ulong global_epoch = 1;
+EbrRecord ebr_records[EBR_MAX_THREADS];
+atomic_int ebr_threads = 0; // Registros já usados alguma vez (os demais nunca precisam ser verificados)
+static _Thread_local EbrRecord *ebr_record = NULL;
+// Devolve o registro da thread quando ela termina, para ser reusado por outra
+pthread_key_t ebr_record_key;
+pthread_once_t ebr_record_once = PTHREAD_ONCE_INIT;
+
+long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void bravo_init(BravoRWLock *lock) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    // Sem preferência por escritores, um fluxo contínuo de leitores no slow path faria os escritores passarem fome
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&lock->underlying, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    for (int i = 0; i < BRAVO_SLOTS; i++) {
+        atomic_init(&lock->slots[i].busy, 0);
+    }
+    atomic_init(&lock->rbias, 1);
+    atomic_init(&lock->inhibit_until, 0);
+}
+
+void bravo_destroy(BravoRWLock *lock) {
+    pthread_rwlock_destroy(&lock->underlying);
+}
+
+// Adquire o lock para leitura e retorna o slot usado no fast path, ou -1 se usou o slow path.
+// O valor retornado deve ser passado para bravo_read_unlock
+int bravo_read_lock(BravoRWLock *lock) {
+    if (atomic_load(&lock->rbias)) {
+        if (thread_slot < 0) {
+            thread_slot = atomic_fetch_add(&next_thread_slot, 1) % BRAVO_SLOTS;
+        }
+        BravoSlot *slot = &lock->slots[thread_slot];
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&slot->busy, &expected, 1)) {
+            // Confirma o viés depois de publicar o slot; um escritor pode tê-lo revogado nesse meio tempo
+            if (atomic_load(&lock->rbias)) {
+                return thread_slot;
+            }
+            atomic_store(&slot->busy, 0);
+        }
+    }
+
+    pthread_rwlock_rdlock(&lock->underlying);
+    if (!atomic_load_explicit(&lock->rbias, memory_order_relaxed) &&
+        now_ns() >= atomic_load_explicit(&lock->inhibit_until, memory_order_relaxed)) {
+        atomic_store(&lock->rbias, 1);
+    }
+    return -1;
+}
+
+void bravo_read_unlock(BravoRWLock *lock, int slot) {
+    if (slot >= 0) {
+        atomic_store_explicit(&lock->slots[slot].busy, 0, memory_order_release);
+    } else {
+        pthread_rwlock_unlock(&lock->underlying);
+    }
+}
+
+void bravo_write_lock(BravoRWLock *lock) {
+    pthread_rwlock_wrlock(&lock->underlying);
+    if (atomic_load_explicit(&lock->rbias, memory_order_relaxed)) {
+        // Revoga o viés e espera os leitores do fast path saírem
+        long start = now_ns();
+        atomic_store(&lock->rbias, 0);
+        for (int i = 0; i < BRAVO_SLOTS; i++) {
+            while (atomic_load(&lock->slots[i].busy)) {
+                sched_yield();
+            }
+        }
+        long end = now_ns();
+        atomic_store_explicit(&lock->inhibit_until, end + (end - start) * BRAVO_INHIBIT_FACTOR,
+                              memory_order_relaxed);
+    }
+}
+
+void bravo_write_unlock(BravoRWLock *lock) {
+    pthread_rwlock_unlock(&lock->underlying);
+}
+
+// Pausa curta da espera ativa, antes de dormir no futex
+void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+void futex_wait(atomic_uint *addr, unsigned expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void futex_wake(atomic_uint *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+void phasefair_read_lock(PhaseFairLock *lock) {
+    unsigned w = atomic_fetch_add(&lock->rin, PF_RINC) & PF_WBITS;
+    if (w == 0) {
+        return;
+    }
+
+    // Há um escritor na fase w: espera os bits de escritor mudarem (fim desta escrita)
+    for (int i = 0; i < PF_SPIN; i++) {
+        if ((atomic_load(&lock->rin) & PF_WBITS) != w) {
+            return;
+        }
+        cpu_relax();
+    }
+    atomic_fetch_add(&lock->readers_sleeping, 1);
     while (1) {
-        pthread_mutex_lock(&read_mutex);
-        while (writer_waiting > 0) {
-            pthread_cond_wait(&read_cond, &read_mutex);
+        unsigned phase = atomic_load(&lock->phase);
+        if ((atomic_load(&lock->rin) & PF_WBITS) != w) {
+            break;
+        }
+        futex_wait(&lock->phase, phase);
+    }
+    atomic_fetch_sub(&lock->readers_sleeping, 1);
+}
+
+void phasefair_read_unlock(PhaseFairLock *lock) {
+    // seq_cst: o leitor escreve rout e lê writer_draining, e o escritor escreve writer_draining e lê rout. Com
+    // ordem mais fraca, cada um pode ver o valor antigo do outro e o escritor dorme em rout sem ser acordado
+    atomic_fetch_add(&lock->rout, PF_RINC);
+    if (atomic_load(&lock->writer_draining)) {
+        futex_wake(&lock->rout, 1);
+    }
+}
+
+void phasefair_write_lock(PhaseFairLock *lock) {
+    // Espera a vez do ticket, dormindo na palavra do próprio ticket
+    unsigned ticket = atomic_fetch_add(&lock->win, 1);
+    atomic_uint *slot = &lock->writer_slots[ticket % PF_WRITER_SLOTS];
+    for (int i = 0; i < PF_SPIN && atomic_load(&lock->wout) != ticket; i++) {
+        cpu_relax();
+    }
+    if (atomic_load(&lock->wout) != ticket) {
+        atomic_fetch_add(&lock->writers_sleeping, 1);
+        while (1) {
+            unsigned v = atomic_load(slot);
+            if (atomic_load(&lock->wout) == ticket) {
+                break;
+            }
+            futex_wait(slot, v);
+        }
+        atomic_fetch_sub(&lock->writers_sleeping, 1);
+    }
+
+    // Bloqueia novos leitores e espera os leitores que já estavam dentro saírem
+    unsigned readers = atomic_fetch_add(&lock->rin, PF_PRES | (ticket & PF_PHID)) & ~PF_WBITS;
+    for (int i = 0; i < PF_SPIN && atomic_load(&lock->rout) != readers; i++) {
+        cpu_relax();
+    }
+    if (atomic_load(&lock->rout) != readers) {
+        atomic_store(&lock->writer_draining, 1);
+        unsigned out;
+        while ((out = atomic_load(&lock->rout)) != readers) {
+            futex_wait(&lock->rout, out);
         }
-        reader_count++;
-        pthread_mutex_unlock(&read_mutex);
+        atomic_store(&lock->writer_draining, 0);
+    }
+}
+
+void phasefair_write_unlock(PhaseFairLock *lock) {
+    // Libera os leitores que chegaram durante a escrita
+    atomic_fetch_and(&lock->rin, ~PF_WBITS);
+    atomic_fetch_add(&lock->phase, 1);
+    if (atomic_load(&lock->readers_sleeping)) {
+        futex_wake(&lock->phase, INT_MAX);
+    }
+
+    // Passa a vez para o próximo ticket
+    unsigned next = atomic_load_explicit(&lock->wout, memory_order_relaxed) + 1;
+    atomic_store(&lock->wout, next);
+    if (atomic_load(&lock->writers_sleeping)) {
+        atomic_uint *slot = &lock->writer_slots[next % PF_WRITER_SLOTS];
+        atomic_fetch_add(slot, 1);
+        futex_wake(slot, INT_MAX);
+    }
+}
+
+// Copia as posições [start, start + count) para dest. Deve ser chamada dentro da seção crítica
+void copy_range(int start, int count, int *dest) {
+    for (int i = 0; i < count; i++) {
+        dest[i] = atomic_load_explicit(&array[start + i], memory_order_relaxed);
+    }
+}
+
+// Aplica um lote de escritas. Deve ser chamada dentro da seção crítica
+void apply_batch(const int *indices, const int *values, int n) {
+    for (int i = 0; i < n; i++) {
+        atomic_store_explicit(&array[indices[i]], values[i], memory_order_relaxed);
+    }
+}
+
+void phasefair_read_range(int start, int count, int *dest) {
+    phasefair_read_lock(&phasefair_lock);
+    copy_range(start, count, dest);
+    phasefair_read_unlock(&phasefair_lock);
+}
+
+void phasefair_write_batch(const int *indices, const int *values, int n) {
+    phasefair_write_lock(&phasefair_lock);
+    apply_batch(indices, values, n);
+    phasefair_write_unlock(&phasefair_lock);
+}
+
+void seqlock_read_range(int start, int count, int *dest) {
+    unsigned before, after;
+    do {
+        before = atomic_load_explicit(&seq, memory_order_acquire);
+        copy_range(start, count, dest);
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&seq, memory_order_relaxed);
+        // Sequência ímpar ou alterada: um escritor estava ativo, a cópia pode estar inconsistente
+    } while ((before & 1) || before != after);
+}
+
+void seqlock_write_batch(const int *indices, const int *values, int n) {
+    pthread_mutex_lock(&seq_write_mutex);
+    unsigned s = atomic_load_explicit(&seq, memory_order_relaxed);
+    atomic_store_explicit(&seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    apply_batch(indices, values, n);
+
+    atomic_store_explicit(&seq, s + 2, memory_order_release);
+    pthread_mutex_unlock(&seq_write_mutex);
+}
+
+void bravo_strategy_init(void) {
+    bravo_init(&bravo_lock);
+}
+
+void bravo_strategy_destroy(void) {
+    bravo_destroy(&bravo_lock);
+}
+
+void bravo_read_range(int start, int count, int *dest) {
+    int slot = bravo_read_lock(&bravo_lock);
+    copy_range(start, count, dest);
+    bravo_read_unlock(&bravo_lock, slot);
+}
+
+void bravo_write_batch(const int *indices, const int *values, int n) {
+    bravo_write_lock(&bravo_lock);
+    apply_batch(indices, values, n);
+    bravo_write_unlock(&bravo_lock);
+}
+
+void stripe_keys_create(void) {
+    pthread_key_create(&stripe_versions_key, free);
+    pthread_key_create(&stripe_touched_key, free);
+}
 
-        int local_copy[ARRAY_SIZE];
-        for (int i = 0; i < ARRAY_SIZE; i++) {
-            local_copy[i] = array[i];
+void striped_init(void) {
+    pthread_once(&stripe_keys_once, stripe_keys_create);
+    num_stripes = (array_size + STRIPE_CELLS - 1) / STRIPE_CELLS;
+    stripes = aligned_alloc(CACHE_LINE, num_stripes * sizeof(Stripe));
+    for (int i = 0; i < num_stripes; i++) {
+        atomic_init(&stripes[i].version, 0);
+        pthread_mutex_init(&stripes[i].mutex, NULL);
+    }
+}
+
+void striped_destroy(void) {
+    for (int i = 0; i < num_stripes; i++) {
+        pthread_mutex_destroy(&stripes[i].mutex);
+    }
+    free(stripes);
+}
+
+// Copia as posições [start, start + count) para dest. A cópia é consistente: corresponde ao
+// estado do intervalo em um único instante, mesmo que ele abranja várias faixas
+void striped_read_range(int start, int count, int *dest) {
+    int first = start / STRIPE_CELLS;
+    int last = (start + count - 1) / STRIPE_CELLS;
+    int n = last - first + 1;
+    if (n > stripe_versions_capacity) {
+        free(stripe_versions);
+        stripe_versions = malloc(n * sizeof(unsigned));
+        stripe_versions_capacity = n;
+        pthread_setspecific(stripe_versions_key, stripe_versions);
+    }
+    unsigned *versions = stripe_versions;
+
+    for (int attempt = 0; attempt < STRIPE_OPTIMISTIC_TRIES; attempt++) {
+        int valid = 1;
+        for (int s = 0; s < n && valid; s++) {
+            versions[s] = atomic_load_explicit(&stripes[first + s].version, memory_order_acquire);
+            valid = !(versions[s] & 1);
+        }
+        if (!valid) {
+            continue;
+        }
+
+        copy_range(start, count, dest);
+        atomic_thread_fence(memory_order_acquire);
+
+        for (int s = 0; s < n && valid; s++) {
+            valid = atomic_load_explicit(&stripes[first + s].version, memory_order_relaxed) == versions[s];
+        }
+        if (valid) {
+            return;
+        }
+    }
+
+    // Muitas escritas concorrentes: trava as faixas em ordem crescente (sem deadlock) e copia
+    for (int s = first; s <= last; s++) {
+        pthread_mutex_lock(&stripes[s].mutex);
+    }
+    copy_range(start, count, dest);
+    for (int s = last; s >= first; s--) {
+        pthread_mutex_unlock(&stripes[s].mutex);
+    }
+}
+
+int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Trava, em ordem crescente, só as faixas que contêm posições do lote, e as deixa com versão
+// ímpar durante toda a escrita: um leitor de qualquer intervalo que cruze o lote ou vê todas
+// as posições antigas ou repete a leitura
+void striped_write_batch(const int *indices, const int *values, int n) {
+    if (n > stripe_touched_capacity) {
+        free(stripe_touched);
+        stripe_touched = malloc(n * sizeof(int));
+        stripe_touched_capacity = n;
+        pthread_setspecific(stripe_touched_key, stripe_touched);
+    }
+    int *touched = stripe_touched;
+    for (int i = 0; i < n; i++) {
+        touched[i] = indices[i] / STRIPE_CELLS;
+    }
+    int m = n;
+    if (n > 1) {
+        qsort(touched, n, sizeof(int), compare_ints);
+        m = 0;
+        for (int i = 0; i < n; i++) {
+            if (m == 0 || touched[m - 1] != touched[i]) {
+                touched[m++] = touched[i];
+            }
         }
+    }
+
+    for (int s = 0; s < m; s++) {
+        Stripe *stripe = &stripes[touched[s]];
+        pthread_mutex_lock(&stripe->mutex);
+        unsigned v = atomic_load_explicit(&stripe->version, memory_order_relaxed);
+        atomic_store_explicit(&stripe->version, v + 1, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    apply_batch(indices, values, n);
+
+    for (int s = m - 1; s >= 0; s--) {
+        Stripe *stripe = &stripes[touched[s]];
+        unsigned v = atomic_load_explicit(&stripe->version, memory_order_relaxed);
+        atomic_store_explicit(&stripe->version, v + 1, memory_order_release);
+        pthread_mutex_unlock(&stripe->mutex);
+    }
+}
+
+void rcu_init(void) {
+    ArrayVersion *version = malloc(sizeof(ArrayVersion) + array_size * sizeof(int));
+    for (int i = 0; i < array_size; i++) {
+        version->cells[i] = atomic_load_explicit(&array[i], memory_order_relaxed);
+    }
+    atomic_init(&current_version, version);
+}
+
+// Deve ser chamada sem leitores ou escritores ativos
+void rcu_destroy(void) {
+    free(atomic_load(&current_version));
+    while (retired_versions != NULL) {
+        ArrayVersion *version = retired_versions;
+        retired_versions = version->next;
+        free(version);
+    }
+}
+
+void ebr_release(void *record) {
+    atomic_store(&((EbrRecord *)record)->state, 0);
+    atomic_store(&((EbrRecord *)record)->in_use, 0);
+}
+
+void ebr_record_key_create(void) {
+    pthread_key_create(&ebr_record_key, ebr_release);
+}
+
+// Reserva um registro livre para a thread atual. Só falha com mais de EBR_MAX_THREADS leitoras vivas ao mesmo tempo
+void ebr_register(void) {
+    pthread_once(&ebr_record_once, ebr_record_key_create);
+    for (int index = 0; index < EBR_MAX_THREADS; index++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ebr_records[index].in_use, &expected, 1)) {
+            int used = atomic_load(&ebr_threads);
+            while (used <= index && !atomic_compare_exchange_weak(&ebr_threads, &used, index + 1)) {
+            }
+            ebr_record = &ebr_records[index];
+            pthread_setspecific(ebr_record_key, ebr_record);
+            return;
+        }
+    }
+    fprintf(stderr, "Mais de %d threads leitoras simultâneas na estratégia rcu\n", EBR_MAX_THREADS);
+    exit(1);
+}
+
+// Marca a thread atual como leitora ativa na época global corrente
+void ebr_enter(void) {
+    if (ebr_record == NULL) {
+        ebr_register();
+    }
+    atomic_store(&ebr_record->state, (atomic_load(&global_epoch) << 1) | 1);
+    // O anúncio precisa ser visível antes de carregar current_version: sem a barreira, a carga (acquire) pode subir
+    // acima do store e o leitor ficar com uma versão que os escritores já consideram fora de uso
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void ebr_exit(void) {
+    atomic_store_explicit(&ebr_record->state, 0, memory_order_release);
+}
+
+// Avança a época global se todos os leitores ativos já estão nela e libera as versões que nenhum
+// leitor pode mais enxergar. Deve ser chamada com rcu_write_mutex travado
+void ebr_reclaim(void) {
+    unsigned long epoch = atomic_load(&global_epoch);
+    int threads = atomic_load(&ebr_threads);
+    int advance = 1;
+    for (int i = 0; i < threads && i < EBR_MAX_THREADS && advance; i++) {
+        unsigned long state = atomic_load(&ebr_records[i].state);
+        advance = !(state & 1) || (state >> 1) == epoch;
+    }
+    if (advance) {
+        atomic_store(&global_epoch, ++epoch);
+    }
+
+    ArrayVersion **link = &retired_versions;
+    while (*link != NULL) {
+        ArrayVersion *version = *link;
+        if (version->retire_epoch + 2 <= epoch) {
+            *link = version->next;
+            free(version);
+        } else {
+            link = &version->next;
+        }
+    }
+}
+
+void rcu_read_range(int start, int count, int *dest) {
+    ebr_enter();
+    ArrayVersion *version = atomic_load_explicit(&current_version, memory_order_acquire);
+    memcpy(dest, version->cells + start, count * sizeof(int));
+    ebr_exit();
+}
+
+// Um lote custa uma única cópia do array, independentemente do número de posições
+void rcu_write_batch(const int *indices, const int *values, int n) {
+    pthread_mutex_lock(&rcu_write_mutex);
+    ArrayVersion *old = atomic_load_explicit(&current_version, memory_order_relaxed);
+    ArrayVersion *version = malloc(sizeof(ArrayVersion) + array_size * sizeof(int));
+    memcpy(version->cells, old->cells, array_size * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        version->cells[indices[i]] = values[i];
+    }
+    atomic_store_explicit(&current_version, version, memory_order_release);
+
+    old->retire_epoch = atomic_load(&global_epoch);
+    old->next = retired_versions;
+    retired_versions = old;
+    ebr_reclaim();
+    pthread_mutex_unlock(&rcu_write_mutex);
+}
+
+Strategy strategies[] = {
+    {"phasefair", NULL, NULL, phasefair_read_range, phasefair_write_batch},
+    {"seqlock", NULL, NULL, seqlock_read_range, seqlock_write_batch},
+    {"bravo", bravo_strategy_init, bravo_strategy_destroy, bravo_read_range, bravo_write_batch},
+    {"striped", striped_init, striped_destroy, striped_read_range, striped_write_batch},
+    {"rcu", rcu_init, rcu_destroy, rcu_read_range, rcu_write_batch},
+};
+#define NUM_STRATEGIES ((int)(sizeof(strategies) / sizeof(strategies[0])))
+Strategy *strategy = &strategies[0];
+
+Strategy *find_strategy(const char *name) {
+    for (int i = 0; i < NUM_STRATEGIES; i++) {
+        if (strcmp(name, strategies[i].name) == 0) {
+            return &strategies[i];
+        }
+    }
+    fprintf(stderr, "Estratégia desconhecida: %s\n", name);
+    return NULL;
+}
+
+// Copia as posições [start, start + count) com a estratégia atual, ou retorna -1 se o intervalo sair do array
+int array_read_range(int start, int count, int *dest) {
+    if (start < 0 || count <= 0 || start > array_size - count) {
+        return -1;
+    }
+    strategy->read_range(start, count, dest);
+    return 0;
+}
+
+// Aplica um lote de escritas com a estratégia atual, ou retorna -1 (sem escrever nada) se alguma posição sair do array
+int array_write_batch(const int *indices, const int *values, int n) {
+    if (n < 0) {
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (indices[i] < 0 || indices[i] >= array_size) {
+            return -1;
+        }
+    }
+    if (n > 0) {
+        strategy->write_batch(indices, values, n);
+    }
+    return 0;
+}
+
+void *reader(void *arg) {
+    int id = *(int *)arg;
+    free(arg);
+    int *local_copy = malloc(array_size * sizeof(int));
+    while (1) {
+        array_read_range(0, array_size, local_copy);
 
         pthread_mutex_lock(&print_mutex);
         printf("Leitor %d leu: [", id);
-        for (int i = 0; i < ARRAY_SIZE; i++) {
+        for (int i = 0; i < array_size && i < PRINT_LIMIT; i++) {
             printf("%d ", local_copy[i]);
         }
+        if (array_size > PRINT_LIMIT) {
+            printf("... (%d posições) ", array_size);
+        }
         printf("]\n");
         pthread_mutex_unlock(&print_mutex);
 
-        usleep(100000); 
-
-        pthread_mutex_lock(&read_mutex);
-        reader_count--;
-        if (reader_count == 0) {
-            pthread_cond_broadcast(&write_cond);
-        }
-        pthread_mutex_unlock(&read_mutex);
+        usleep(100000);
     }
+    free(local_copy);
     return NULL;
 }
 
 void *writer(void *arg) {
     int id = *(int *)arg;
     free(arg);
+    int indices[WRITE_BATCH], values[WRITE_BATCH];
     while (1) {
-        pthread_mutex_lock(&ticket_mutex);
-        unsigned long my_ticket = next_ticket++;
-        pthread_mutex_unlock(&ticket_mutex);
+        // O mesmo valor em todas as posições do lote: como a escrita é atômica, nenhum leitor
+        // vê só uma parte delas com o valor novo
+        int value = rand() % 100;
+        for (int i = 0; i < WRITE_BATCH; i++) {
+            indices[i] = rand() % array_size;
+            values[i] = value;
+        }
+        array_write_batch(indices, values, WRITE_BATCH);
 
-        // Espera até ser a vez deste escritor
-        pthread_mutex_lock(&ticket_mutex);
-        while (current_ticket != my_ticket) {
-            pthread_cond_wait(&ticket_cond, &ticket_mutex);
+        pthread_mutex_lock(&print_mutex);
+        printf("Escritor %d escreveu %d nas posições [", id, value);
+        for (int i = 0; i < WRITE_BATCH; i++) {
+            printf("%d ", indices[i]);
         }
-        pthread_mutex_unlock(&ticket_mutex);
+        printf("]\n");
+        pthread_mutex_unlock(&print_mutex);
 
-        // Bloqueia acesso para escrita
-        pthread_mutex_lock(&write_mutex);
+        usleep(100000);
+    }
+    return NULL;
+}
 
-        pthread_mutex_lock(&read_mutex);
-        writer_waiting++;
-        while (reader_count > 0) {
-            pthread_cond_wait(&write_cond, &read_mutex);
-        }
-        writer_waiting--;
-        pthread_mutex_unlock(&read_mutex);
+// Retorna a faixa do histograma de um valor: exata abaixo de HIST_SUB, depois HIST_SUB faixas por potência de 2
+int histogram_bucket(unsigned long value) {
+    if (value < HIST_SUB) {
+        return (int)value;
+    }
+    int shift = 63 - __builtin_clzl(value) - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((value >> shift) & (HIST_SUB - 1));
+}
 
-        int index = rand() % ARRAY_SIZE;
-        int value = rand() % 100;
-        array[index] = value;
+void histogram_record(Histogram *hist, long value) {
+    unsigned long v = value > 0 ? (unsigned long)value : 0;
+    hist->count++;
+    if (v > hist->max) {
+        hist->max = v;
+    }
+    hist->buckets[histogram_bucket(v)]++;
+}
 
-        pthread_mutex_lock(&print_mutex);
-        printf("Escritor %d escreveu %d na posição %d\n", id, value, index);
-        pthread_mutex_unlock(&print_mutex);
+void histogram_merge(Histogram *into, const Histogram *from) {
+    into->count += from->count;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        into->buckets[b] += from->buckets[b];
+    }
+}
 
-        usleep(100000);
+// Retorna o percentil p (0 a 100) de um histograma, com a precisão da faixa
+unsigned long histogram_percentile(const Histogram *hist, double p) {
+    unsigned long target = (unsigned long)(hist->count * p / 100.0);
+    unsigned long seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen > target) {
+            if (b < HIST_SUB) {
+                return b;
+            }
+            return (unsigned long)(HIST_SUB + b % HIST_SUB) << (b / HIST_SUB - 1);
+        }
+    }
+    return hist->max;
+}
 
-        pthread_mutex_unlock(&write_mutex);
+atomic_int bench_stop;
+int bench_read_pct = 90;
+int bench_batch = 1;       // Posições por escrita
+int bench_read_len = 0;    // Posições por leitura (0: o array inteiro)
+int bench_verify = 0;      // Confere a atomicidade dos lotes (-v)
 
-        // Avança para o próximo ticket
-        pthread_mutex_lock(&ticket_mutex);
-        current_ticket++;
-        pthread_cond_broadcast(&ticket_cond);
-        pthread_mutex_unlock(&ticket_mutex);
+// Com -v, o lote g ocupa as posições [g * bench_batch, (g + 1) * bench_batch) e grava um único valor nelas.
+// Retorna 1 se algum lote inteiro dentro do intervalo lido não tiver um único valor
+int torn_read(int start, const int *dest) {
+    int first = (start + bench_batch - 1) / bench_batch;
+    for (int g = first; (g + 1) * bench_batch <= start + bench_read_len; g++) {
+        const int *cells = dest + g * bench_batch - start;
+        for (int i = 1; i < bench_batch; i++) {
+            if (cells[i] != cells[0]) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void *bench_thread(void *arg) {
+    BenchThread *self = (BenchThread *)arg;
+    while (!atomic_load_explicit(&bench_stop, memory_order_relaxed)) {
+        int is_read = (int)(rand_r(&self->seed) % 100) < bench_read_pct;
+        int read_start = 0;
+        if (is_read) {
+            read_start = rand_r(&self->seed) % (array_size - bench_read_len + 1);
+        } else if (bench_verify) {
+            int group = rand_r(&self->seed) % (array_size / bench_batch);
+            int value = rand_r(&self->seed);
+            for (int i = 0; i < bench_batch; i++) {
+                self->indices[i] = group * bench_batch + i;
+                self->values[i] = value;
+            }
+        } else {
+            for (int i = 0; i < bench_batch; i++) {
+                self->indices[i] = rand_r(&self->seed) % array_size;
+                self->values[i] = rand_r(&self->seed) % 100;
+            }
+        }
+
+        long start = now_ns();
+        if (is_read) {
+            strategy->read_range(read_start, bench_read_len, self->buffer);
+        } else {
+            strategy->write_batch(self->indices, self->values, bench_batch);
+        }
+        long latency = now_ns() - start;
 
-        pthread_mutex_lock(&read_mutex);
-        pthread_cond_broadcast(&read_cond);
-        pthread_mutex_unlock(&read_mutex);
+        histogram_record(is_read ? &self->reads : &self->writes, latency);
+        if (is_read && bench_verify) {
+            self->torn += torn_read(read_start, self->buffer);
+        }
     }
     return NULL;
 }
 
-int main() {
+// Executa o benchmark da estratégia atual e imprime uma linha CSV com os resultados. Retorna o número de leituras
+// que viram um lote pela metade (sempre 0 sem -v)
+unsigned long run_benchmark(int num_threads, double duration) {
+    for (int i = 0; i < array_size; i++) {
+        atomic_store(&array[i], 0);
+    }
+    if (strategy->init != NULL) {
+        strategy->init();
+    }
+
+    BenchThread *threads = calloc(num_threads, sizeof(BenchThread));
+    atomic_store(&bench_stop, 0);
+    long start = now_ns();
+    for (int i = 0; i < num_threads; i++) {
+        threads[i].seed = (unsigned)time(NULL) ^ (unsigned)(i * 2654435761u);
+        threads[i].buffer = malloc(bench_read_len * sizeof(int));
+        threads[i].indices = malloc(bench_batch * sizeof(int));
+        threads[i].values = malloc(bench_batch * sizeof(int));
+        pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]);
+    }
+    // nanosleep em vez de usleep, que pode rejeitar (EINVAL) esperas de 1 s ou mais
+    struct timespec wait = {(time_t)duration, (long)((duration - (time_t)duration) * 1e9)};
+    while (nanosleep(&wait, &wait) != 0) {
+    }
+    atomic_store(&bench_stop, 1);
+
+    Histogram *reads = calloc(1, sizeof(Histogram));
+    Histogram *writes = calloc(1, sizeof(Histogram));
+    unsigned long torn = 0;
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        torn += threads[i].torn;
+        histogram_merge(reads, &threads[i].reads);
+        histogram_merge(writes, &threads[i].writes);
+        free(threads[i].buffer);
+        free(threads[i].indices);
+        free(threads[i].values);
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    unsigned long ops = reads->count + writes->count;
+    printf("%s,%d,%d,%d,%d,%d,%.3f,%lu,%.0f,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,",
+           strategy->name, num_threads, bench_read_pct, array_size, bench_batch, bench_read_len,
+           elapsed, ops, ops / elapsed,
+           reads->count, writes->count,
+           histogram_percentile(reads, 50), histogram_percentile(reads, 99), histogram_percentile(reads, 99.9),
+           histogram_percentile(writes, 50), histogram_percentile(writes, 99), histogram_percentile(writes, 99.9),
+           reads->max, writes->max);
+    if (bench_verify) {
+        printf("%lu", torn);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    free(reads);
+    free(writes);
+    free(threads);
+    if (strategy->destroy != NULL) {
+        strategy->destroy();
+    }
+    return torn;
+}
+
+// Interpreta as opções do modo benchmark e executa as estratégias pedidas
+int benchmark_main(int argc, char *argv[]) {
+    const char *strategy_name = "all";
+    int num_threads = 4;
+    double duration = 1.0;
+    int header = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "bs:t:r:d:n:k:l:vH")) != -1) {
+        switch (opt) {
+        case 'b':
+            break;
+        case 's':
+            strategy_name = optarg;
+            break;
+        case 't':
+            num_threads = atoi(optarg);
+            break;
+        case 'r':
+            bench_read_pct = atoi(optarg);
+            break;
+        case 'd':
+            duration = atof(optarg);
+            break;
+        case 'n':
+            array_size = atoi(optarg);
+            break;
+        case 'k':
+            bench_batch = atoi(optarg);
+            break;
+        case 'l':
+            bench_read_len = atoi(optarg);
+            break;
+        case 'v':
+            bench_verify = 1;
+            break;
+        case 'H':
+            header = 0;
+            break;
+        default:
+            fprintf(stderr, "Uso: %s -b [-s estrategia|all] [-t threads] [-r %%leitura] [-d segundos] [-n tamanho] "
+                    "[-k posições por escrita] [-l posições por leitura] [-v] [-H]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (bench_read_len == 0) {
+        bench_read_len = array_size;
+    }
+    if (num_threads <= 0 || bench_read_pct < 0 || bench_read_pct > 100 || duration <= 0 || array_size <= 0 ||
+        bench_batch <= 0 || bench_read_len <= 0 || bench_read_len > array_size ||
+        (bench_verify && bench_batch > array_size)) {
+        fprintf(stderr, "Parâmetros de benchmark inválidos\n");
+        return 1;
+    }
+
+    Strategy *selected = NULL;
+    if (strcmp(strategy_name, "all") != 0 && (selected = find_strategy(strategy_name)) == NULL) {
+        return 1;
+    }
+    if ((selected == NULL || selected->read_range == rcu_read_range) && num_threads > EBR_MAX_THREADS) {
+        fprintf(stderr, "A estratégia rcu aceita no máximo %d threads\n", EBR_MAX_THREADS);
+        return 1;
+    }
+
+    array = malloc(array_size * sizeof(atomic_int));
+    if (header) {
+        printf("strategy,threads,read_pct,array_size,batch,read_len,duration_s,ops,ops_per_sec,reads,writes,"
+               "read_p50_ns,read_p99_ns,read_p999_ns,write_p50_ns,write_p99_ns,write_p999_ns,"
+               "read_max_ns,write_max_ns,torn_reads\n");
+    }
+    unsigned long torn = 0;
+    for (int i = 0; i < NUM_STRATEGIES; i++) {
+        if (selected == NULL || selected == &strategies[i]) {
+            strategy = &strategies[i];
+            torn += run_benchmark(num_threads, duration);
+        }
+    }
+    free(array);
+    if (torn > 0) {
+        fprintf(stderr, "%lu leituras viram um lote de escrita pela metade\n", torn);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
     pthread_t readers[NUM_READERS], writers[NUM_WRITERS];
     srand(time(NULL));
 
-    for (int i = 0; i < ARRAY_SIZE; i++) {
-        array[i] = 0;
+    if (argc > 1 && argv[1][0] == '-') {
+        return benchmark_main(argc, argv);
+    }
+
+    if (argc > 1 && (strategy = find_strategy(argv[1])) == NULL) {
+        return 1;
+    }
+
+    if (argc > 2) {
+        array_size = atoi(argv[2]);
+        if (array_size <= 0) {
+            fprintf(stderr, "Tamanho de array inválido: %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    array = malloc(array_size * sizeof(atomic_int));
+    for (int i = 0; i < array_size; i++) {
+        atomic_init(&array[i], 0);
+    }
+
+    if (strategy->init != NULL) {
+        strategy->init();
     }
 
     for (int i = 0; i < NUM_READERS; i++) {
@@ -152,4 +1091,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -3,4 +3,4 @@
 
 gcc -o ex6 ex6.c
 
-./ex6
+./ex6 "$@"